@@ -56,6 +56,12 @@ SOURCES += \
     src/historymodel.cpp \
     src/filesystemmodel.cpp \
     src/localstoremodel.cpp \
+    src/messageindex.cpp \
+    src/vfsnamecache.cpp \
+    src/blobindex.cpp \
+    src/mediatypes.cpp \
+    src/dirsizes.cpp \
+    src/chunkpipe.cpp \
     src/main.cpp
 
 HEADERS += \
@@ -64,7 +70,13 @@ HEADERS += \
     include/contactmodel.h \
     include/historymodel.h \
     include/filesystemmodel.h \
-    include/localstoremodel.h
+    include/localstoremodel.h \
+    include/messageindex.h \
+    include/vfsnamecache.h \
+    include/blobindex.h \
+    include/mediatypes.h \
+    include/dirsizes.h \
+    include/chunkpipe.h
 
 ## ============================================================ ##
 
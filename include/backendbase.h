@@ -34,12 +34,17 @@
 #include <QQmlEngine>
 #include <QJSValue>
 #include <QRunnable>
+#include <QThreadPool>
 
 #include "imageservice.h"
 #include "contactmodel.h"
 #include "historymodel.h"
 #include "filesystemmodel.h"
 #include "localstoremodel.h"
+#include "messageindex.h"
+#include "blobindex.h"
+#include "mediatypes.h"
+#include "dirsizes.h"
 
 #include <Zway/client.h>
 
@@ -119,6 +124,14 @@ public:
 
     Q_INVOKABLE QVariant latestHistoryModel(quint32 dst);
 
+    Q_INVOKABLE QVariant historyModel(quint32 historyId);
+
+    Q_INVOKABLE void touchHistoryModel(quint32 historyId);
+
+    Q_INVOKABLE void setHistoryRowBudget(quint32 numRows);
+
+    Q_INVOKABLE QJsonObject historyModelStats();
+
 
     Q_INVOKABLE void deleteRequest(quint32 id, const QJSValue &callback = QJSValue());
 
@@ -132,14 +145,35 @@ public:
     Q_INVOKABLE void resetInbox(quint32 contactId);
 
 
+    Q_INVOKABLE QVariantList searchMessages(const QString &query, quint32 contactId = 0, quint32 limit = 50);
+
+
+    QHash<quint32, quint32> inboxCounts(const QList<quint32> &contactIds);
+
+    QHash<quint32, qint32> contactStatuses(const QList<quint32> &contactIds);
+
+    Q_INVOKABLE QVariantMap contactStatusTable();
+
+
     bool findContact(const UBJ::Value &query, RequestCallback callback = nullptr);
 
 
     bool processDispatchRequest(const UBJ::Object &args, RequestCallback callback=nullptr);
 
+    void receiveResource(const UBJ::Object &message, const UBJ::Object &resource);
+
     bool processResourceRecv(UBJ::Object &message, UBJ::Object &resource);
 
 
+    void evictHistoryModels();
+
+    BlobIndex &blobIndex();
+
+    MediaTypes &mediaTypes();
+
+    DirSizes &dirSizes();
+
+
     static UBJ::Value jsonToUbj(const QJsonValue &val);
 
     static UBJ::Object jsonObjToUbj(const QJsonObject &obj);
@@ -155,6 +189,8 @@ public:
 
     QQmlEngine *engine();
 
+    QJsonObject theme();
+
 
 private slots:
 
@@ -162,6 +198,10 @@ private slots:
 
     void onInvokeCallback(const QJSValue &callback, const QVariantList &args);
 
+    void onStoreUnlocked();
+
+    void onMessage(const QJsonObject &message);
+
 
 signals:
 
@@ -193,7 +233,11 @@ signals:
 
     void contactRequestRejected(const QJsonObject &args);
 
-    void contactStatusChanged();
+    void contactStatusChanged(quint32 contactId, qint32 status);
+
+    void contactStatusesChanged();
+
+    void inboxChanged(quint32 contactId, quint32 count);
 
     void messageIncoming(const QJsonObject &message);
 
@@ -232,6 +276,8 @@ protected:
 
     qreal m_sp;
 
+    QJsonObject m_theme;
+
     bool m_active;
 
     ContactModel m_contactModel;
@@ -242,6 +288,28 @@ protected:
 
     QMap<quint32, std::shared_ptr<HistoryModel>> m_historyModels;
 
+    QList<quint32> m_historyModelsLru;
+
+    quint32 m_historyRowBudget;
+
+    MessageIndex m_messageIndex;
+
+    BlobIndex m_blobIndex;
+
+    MediaTypes m_mediaTypes;
+
+    DirSizes m_dirSizes;
+
+    QThreadPool m_resourcePool;
+
+    QHash<quint32, quint32> m_inboxCounts;
+
+    QMutex m_inboxCountsMutex;
+
+    QHash<quint32, qint32> m_contactStatuses;
+
+    QMutex m_contactStatusesMutex;
+
     QString m_storeDir;
 
     QString m_storeFile;
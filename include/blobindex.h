@@ -0,0 +1,105 @@
+
+// ============================================================ //
+//
+//   d88888D db   d8b   db  .d8b.  db    db
+//   YP  d8' 88   I8I   88 d8' `8b `8b  d8'
+//      d8'  88   I8I   88 88ooo88  `8bd8'
+//     d8'   Y8   I8I   88 88~~~88    88
+//    d8' db `8b d8'8b d8' 88   88    88
+//   d88888P  `8b8' `8d8'  YP   YP    YP
+//
+//   open-source, cross-platform, crypto-messenger
+//
+//   Copyright (C) 2018 Marc Weiler
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program. If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================ //
+
+#ifndef BLOBINDEX_H
+#define BLOBINDEX_H
+
+#include <QHash>
+#include <QMutex>
+#include <QByteArray>
+
+#include <Zway/store.h>
+
+using namespace Zway;
+
+// ============================================================ //
+
+/**
+ * @brief The BlobIndex class
+ *
+ * Maps content hashes to store blobs and counts the vfs nodes that
+ * reference each blob. The index is built from the vfs table the first
+ * time it is used after the store was unlocked.
+ */
+
+class BlobIndex
+{
+public:
+
+    class Entry
+    {
+    public:
+
+        QByteArray m_hash;
+
+        uint64_t m_size = 0;
+
+        quint32 m_refs = 0;
+    };
+
+    BlobIndex();
+
+    void clear();
+
+    void load(Store$ store);
+
+    bool hasSize(uint64_t size);
+
+    uint64_t acquire(const std::string &hash, uint64_t size);
+
+    void addRef(uint64_t blobId, const std::string &hash, uint64_t size);
+
+    bool release(uint64_t blobId);
+
+    quint32 numRefs(uint64_t blobId);
+
+    static std::string hashBlob(Store$ store, uint64_t blobId, uint64_t &size);
+
+    static bool isContentHash(const std::string &hash);
+
+private:
+
+    void addRefUnlocked(uint64_t blobId, const QByteArray &hash, uint64_t size);
+
+private:
+
+    QHash<uint64_t, Entry> m_blobs;
+
+    QHash<QByteArray, uint64_t> m_hashes;
+
+    QHash<uint64_t, quint32> m_sizes;
+
+    bool m_loaded;
+
+    QMutex m_mutex;
+};
+
+// ============================================================ //
+
+#endif // BLOBINDEX_H
@@ -0,0 +1,96 @@
+
+// ============================================================ //
+//
+//   d88888D db   d8b   db  .d8b.  db    db
+//   YP  d8' 88   I8I   88 d8' `8b `8b  d8'
+//      d8'  88   I8I   88 88ooo88  `8bd8'
+//     d8'   Y8   I8I   88 88~~~88    88
+//    d8' db `8b d8'8b d8' 88   88    88
+//   d88888P  `8b8' `8d8'  YP   YP    YP
+//
+//   open-source, cross-platform, crypto-messenger
+//
+//   Copyright (C) 2018 Marc Weiler
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef CHUNKPIPE_H
+#define CHUNKPIPE_H
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <Zway/memorybuffer.h>
+
+#include <functional>
+#include <thread>
+
+using namespace Zway;
+
+// ============================================================ //
+
+/**
+ * @brief The ChunkPipe class
+ *
+ * Runs one side of a chunked transfer on a single companion thread
+ * which lives as long as the transfer. The caller hands over one chunk
+ * at a time and fills its second buffer meanwhile, so reading and
+ * writing overlap without starting a thread per chunk.
+ */
+
+class ChunkPipe
+{
+public:
+
+    typedef std::function<bool (MemoryBuffer$ buf, uint32_t numBytes, uint64_t offset)> Handler;
+
+    ChunkPipe(Handler handler);
+
+    ~ChunkPipe();
+
+    void push(MemoryBuffer$ buf, uint32_t numBytes, uint64_t offset);
+
+    bool wait();
+
+private:
+
+    void run();
+
+private:
+
+    Handler m_handler;
+
+    MemoryBuffer$ m_buf;
+
+    uint32_t m_numBytes;
+
+    uint64_t m_offset;
+
+    bool m_busy;
+
+    bool m_failed;
+
+    bool m_stop;
+
+    QMutex m_mutex;
+
+    QWaitCondition m_cond;
+
+    std::thread m_thread;
+};
+
+// ============================================================ //
+
+#endif // CHUNKPIPE_H
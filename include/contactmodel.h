@@ -33,6 +33,10 @@
 #include <QAbstractListModel>
 #include <QJSValue>
 #include <QJsonArray>
+#include <QJsonObject>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
 
 class BackendBase;
 
@@ -60,6 +64,58 @@ public:
         AddCodeRole
     };
 
+    enum Group {
+        NoGroup,
+        ContactGroup,
+        RequestGroup
+    };
+
+    class ContactRow
+    {
+    public:
+
+        static ContactRow fromJson(const QJsonObject &obj);
+
+        QJsonObject toJson() const;
+
+        quint64 key() const { return ((quint64)m_group << 32) | m_id; }
+
+        bool operator==(const ContactRow &other) const;
+
+        bool operator!=(const ContactRow &other) const { return !(*this == other); }
+
+        quint32 m_id = 0;
+
+        Group m_group = NoGroup;
+
+        // negative values mark fields the row does not carry
+
+        qint32 m_type = -1;
+
+        qint32 m_status = -1;
+
+        qint32 m_inbox = -1;
+
+        QString m_color;
+
+        QString m_name;
+
+        QString m_phone;
+
+        QString m_addCode;
+    };
+
+    typedef QVector<ContactRow> ContactRows;
+
+    class SearchResult
+    {
+    public:
+
+        ContactRows m_items;
+
+        QElapsedTimer m_timer;
+    };
+
     explicit ContactModel(BackendBase *backend);
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const;
@@ -68,9 +124,19 @@ public:
 
     Q_INVOKABLE QJsonValue get(int index);
 
+    Q_INVOKABLE void setFilter(const QString &filter);
+
+    static QString intern(const QString &str);
+
+    static QString fold(const QString &str);
+
+    static QString digits(const QString &str);
+
 signals:
 
-    void updateView(const QJsonArray &items);
+    void searchResult(const ContactModel::ContactRows &items, bool error, quint32 seq, const QString &query);
+
+    void updateContacts(const ContactModel::ContactRows &items);
 
 public slots:
 
@@ -78,19 +144,79 @@ public slots:
 
     void clearItems();
 
-    void onUpdateView(const QJsonArray &items);
+    void onUpdateView(const ContactModel::ContactRows &items);
+
+    void onUpdateContacts(const ContactModel::ContactRows &items);
+
+    void onFilterTimeout();
+
+    void onSearchResult(const ContactModel::ContactRows &items, bool error, quint32 seq, const QString &query);
+
+    void onContactStatusChanged(quint32 contactId, qint32 status);
+
+    void onContactStatusesChanged();
+
+    void onInboxChanged(quint32 contactId, quint32 count);
+
+    void onContactRequest();
 
 protected:
 
+    void loadContacts(const QJSValue &callback = QJSValue());
+
+    void startSearch(const QString &query, const QJSValue &callback);
+
+    void cancelSearch();
+
+    void updateFilterIndex();
+
+    QVector<qint32> filterContacts(const QString &filter);
+
+    ContactRows filteredItems();
+
+    qint32 contactRow(quint32 contactId);
+
+    void updateRows();
+
     QHash<int, QByteArray> roleNames() const;
 
 private:
 
     BackendBase* m_backend;
 
-    QJsonArray m_items;
+    ContactRows m_items;
+
+    QHash<quint64, qint32> m_rows;
+
+    ContactRows m_allItems;
+
+    QHash<quint64, qint32> m_allRows;
+
+    QVector<qint32> m_contactRows;
+
+    QVector<QString> m_foldedNames;
+
+    QVector<QString> m_phoneDigits;
+
+    QHash<QString, QVector<qint32>> m_trigrams;
+
+    QString m_filter;
+
+    QString m_lastFilter;
+
+    QVector<qint32> m_lastMatches;
+
+    QTimer m_filterTimer;
+
+    quint32 m_searchSeq;
+
+    QHash<QString, SearchResult> m_searchCache;
+
+    bool m_local;
 };
 
+Q_DECLARE_METATYPE(ContactModel::ContactRows)
+
 // ============================================================ //
 
 #endif // CONTACTMODEL_H
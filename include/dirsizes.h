@@ -0,0 +1,94 @@
+
+// ============================================================ //
+//
+//   d88888D db   d8b   db  .d8b.  db    db
+//   YP  d8' 88   I8I   88 d8' `8b `8b  d8'
+//      d8'  88   I8I   88 88ooo88  `8bd8'
+//     d8'   Y8   I8I   88 88~~~88    88
+//    d8' db `8b d8'8b d8' 88   88    88
+//   d88888P  `8b8' `8d8'  YP   YP    YP
+//
+//   open-source, cross-platform, crypto-messenger
+//
+//   Copyright (C) 2018 Marc Weiler
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program. If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================ //
+
+#ifndef DIRSIZES_H
+#define DIRSIZES_H
+
+#include <QHash>
+#include <QMutex>
+
+#include <Zway/store.h>
+
+using namespace Zway;
+
+// ============================================================ //
+
+/**
+ * @brief The DirSizes class
+ *
+ * Caches the recursive size and item count of vfs directories. A
+ * directory is only cached together with all of its subdirectories, so
+ * walking up from a changed directory can stop at the first one that is
+ * not cached. Single node changes adjust the cached totals in place,
+ * bulk changes drop them so the next aggregation recomputes the path.
+ */
+
+class DirSizes
+{
+public:
+
+    class Entry
+    {
+    public:
+
+        uint64_t m_size = 0;
+
+        quint32 m_numItems = 0;
+    };
+
+    DirSizes();
+
+    void clear();
+
+    bool get(uint64_t dirId, Entry &entry);
+
+    Entry aggregate(Store$ store, uint64_t dirId);
+
+    void adjust(Store$ store, uint64_t dirId, int64_t size, qint32 numItems);
+
+    void invalidate(Store$ store, uint64_t dirId);
+
+    void remove(uint64_t dirId);
+
+private:
+
+    bool parentDir(Store$ store, uint64_t &dirId);
+
+private:
+
+    QHash<uint64_t, Entry> m_entries;
+
+    quint32 m_generation;
+
+    QMutex m_mutex;
+};
+
+// ============================================================ //
+
+#endif // DIRSIZES_H
@@ -33,8 +33,16 @@
 #include <QAbstractListModel>
 #include <QJSValue>
 #include <QFileInfoList>
+#include <QVector>
+#include <QMutex>
+#include <QThreadPool>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+#include <atomic>
 
 class BackendBase;
+class MediaTypes;
 
 // ============================================================ //
 
@@ -53,9 +61,50 @@ public:
         TypeRole,
         NameRole,
         SizeRole,
+        TimeRole,
+        MediaTypeRole,
         OriginRole
     };
 
+    enum SortKey {
+        SortByName,
+        SortBySize,
+        SortByTime
+    };
+
+    /**
+     * @brief One listed entry, filled on the worker so data() never stats
+     */
+
+    class FileRow
+    {
+    public:
+
+        FileRow()
+            : m_type(0),
+              m_size(0),
+              m_time(0),
+              m_mediaType(0) {}
+
+        static FileRow fromInfo(const QFileInfo &info, MediaTypes *mediaTypes = nullptr);
+
+        QString m_path;
+
+        QString m_name;
+
+        QString m_sortName;
+
+        qint32 m_type;
+
+        qint64 m_size;
+
+        qint64 m_time;
+
+        qint32 m_mediaType;
+    };
+
+    typedef QVector<FileRow> FileRows;
+
     explicit FileSystemModel(BackendBase *backend = nullptr);
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const;
@@ -74,24 +123,82 @@ public:
 
     Q_INVOKABLE void clear();
 
+    Q_INVOKABLE void sort(qint32 key, bool ascending = true);
+
+    Q_INVOKABLE void setMediaFilter(qint32 mediaType);
+
+    Q_INVOKABLE void detectMediaType(qint32 index, const QJSValue &callback = QJSValue());
+
     Q_INVOKABLE void createDirectory(const QString &name, const QString &parent, const QJSValue &callback = QJSValue());
 
     Q_INVOKABLE void deleteItems(const QVariantList &items, const QJSValue &callback = QJSValue());
 
+    Q_INVOKABLE void cancelDelete();
+
+    Q_INVOKABLE void setExportChunkSize(quint32 chunkSize);
+
+    Q_INVOKABLE void setExportThreads(qint32 numThreads);
+
+    Q_INVOKABLE void cancelCopy();
+
+    Q_INVOKABLE void setCopyThreads(qint32 numThreads);
+
     Q_INVOKABLE void pasteFromFileSystem(const QVariantList &items, const QString& dst, const QJSValue &callback = QJSValue());
 
     Q_INVOKABLE void pasteFromLocalStore(const QVariantList &items, const QString& dst, const QJSValue &callback = QJSValue());
 
+signals:
+
+    void deleteProgress(quint32 numDeleted, bool finished);
+
+    void copyProgress(quint32 filesDone, quint32 filesTotal, quint64 bytesDone, quint64 bytesTotal, double bytesPerSecond);
+
+    void numItemsTotalChanged();
+
+    void insertEntries(quint32 seq, const FileRows &entries, bool finished);
+
+    void refreshEntries(quint32 seq, const FileRows &entries);
+
+    void mediaTypeDetected(quint32 seq, qint32 index, const QString &path, qint32 mediaType, const QJSValue &callback);
+
+public slots:
+
+    void onInsertEntries(quint32 seq, const FileRows &entries, bool finished);
+
+    void onRefreshEntries(quint32 seq, const FileRows &entries);
+
+    void onMediaTypeDetected(quint32 seq, qint32 index, const QString &path, qint32 mediaType, const QJSValue &callback);
+
+    void onDirectoryChanged(const QString &path);
+
+    void refresh();
+
 private:
 
-    bool copyFile(const QString &src, const QString &dst);
+    void sortEntries();
+
+    static void sortEntries(FileRows &entries, qint32 key, bool ascending);
+
+    static FileRows filterEntries(const FileRows &entries, qint32 mediaType);
+
+    static void invokeCallbacks(QList<QJSValue> &callbacks, qint32 numItems);
+
+    void storeSnapshot(const QString &path, const FileRows &entries);
+
+    void dropSnapshot(const QString &path);
+
 
-    bool copyDirectory(const QString &src, const QString &dst, bool recursive = true);
+    void removeEntries();
 
 
-    bool copyResource(uint64_t src, const QString &dst);
+    bool copyTree(const QStringList &paths, const QString &dst);
 
-    bool copyDirectory(uint64_t src, const QString &dst, bool recursive = true);
+    bool copyFileData(const QString &src, const QString &dst, std::atomic<quint64> &bytesDone);
+
+
+    bool exportTree(const QList<uint64_t> &ids, const QString &dst);
+
+    bool exportBlob(uint64_t blobId, const QString &path);
 
 
     QHash<int, QByteArray> roleNames() const;
@@ -106,9 +213,51 @@ private:
 
     quint32 m_numItemsTotal;
 
-    QFileInfoList m_itemsFull;
+    FileRows m_entries;
+
+    FileRows m_itemsFull;
+
+    FileRows m_items;
+
+    QMutex m_deleteMutex;
+
+    QList<QPair<QString, QString>> m_deleteEntries;
+
+    bool m_deleteRunning;
+
+    QAtomicInt m_deleteCancelled;
+
+    quint32 m_exportChunkSize;
+
+    QThreadPool m_exportPool;
+
+    QAtomicInt m_listSeq;
+
+    bool m_listing;
+
+    qint32 m_pendingItems;
+
+    QList<QJSValue> m_pendingCallbacks;
+
+    QHash<QString, FileRows> m_snapshots;
+
+    QStringList m_snapshotsLru;
+
+    QFileSystemWatcher m_watcher;
+
+    QTimer m_refreshTimer;
+
+    QAtomicInt m_copyCancelled;
+
+    quint32 m_copyChunkSize;
+
+    QThreadPool m_copyPool;
+
+    qint32 m_sortKey;
+
+    bool m_sortAscending;
 
-    QFileInfoList m_items;
+    qint32 m_mediaFilter;
 };
 
 // ============================================================ //
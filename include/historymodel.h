@@ -32,6 +32,7 @@
 
 #include <QAbstractListModel>
 #include <QJSValue>
+#include <QMutex>
 
 #include <Zway/message/message.h>
 
@@ -49,6 +50,21 @@ class HistoryModel : public QAbstractListModel
 {
     Q_OBJECT
 
+    class TextLayout
+    {
+    public:
+
+        QString m_text;
+
+        QString m_displayText;
+
+        QString m_plainText;
+
+        qreal m_width = 0;
+
+        qreal m_height = 0;
+    };
+
 public:
 
     enum Roles {
@@ -57,7 +73,13 @@ public:
         DstRole,
         StatusRole,
         TimeRole,
-        TextRole
+        TextRole,
+        DisplayTextRole,
+        PlainTextRole,
+        TextWidthRole,
+        TextHeightRole,
+        NumResourcesRole,
+        ResourcesRole
     };
 
     explicit HistoryModel(BackendBase *backend, quint32 historyId);
@@ -74,10 +96,30 @@ public:
 
     Q_INVOKABLE qint32 messageIndex(quint32 id);
 
+    Q_INVOKABLE qint32 messageRow(quint32 id);
+
+    Q_INVOKABLE void loadAround(quint32 messageId, qint32 numItems = 50, const QJSValue &callback = QJSValue());
+
+    Q_INVOKABLE void moreItems(qint32 numItems, bool older = true, const QJSValue &callback = QJSValue());
+
+    Q_INVOKABLE bool hasOlder();
+
+    Q_INVOKABLE bool hasNewer();
+
+    Q_INVOKABLE quint32 historyId();
+
+    Q_INVOKABLE bool loaded();
+
+    void release();
+
 signals:
 
     void updateView(const QVariantList &items);
 
+    void updateWindow(const QVariantList &items, quint32 offset, quint32 total);
+
+    void insertItems(const QVariantList &items, bool older, quint32 total, quint32 begin, quint32 seq, const QJSValue &callback);
+
 public slots:
 
     void updateItems(const QJSValue &callback = QJSValue());
@@ -86,11 +128,25 @@ public slots:
 
     void onUpdateView(const QVariantList &items);
 
+    void onUpdateWindow(const QVariantList &items, quint32 offset, quint32 total);
+
+    void onInsertItems(const QVariantList &items, bool older, quint32 total, quint32 begin, quint32 seq, const QJSValue &callback);
+
 protected:
 
+    QList<Message$> loadMessages();
+
+    void updateIndexes();
+
     QVariantMap messageToVariant(Message$ message);
 
-    QVariantMap resourceToVariant(Resource$ resource);
+    QVariantMap resourceToVariant(Resource$ resource) const;
+
+    QVariantList resources(const QVariantMap &message) const;
+
+    void processText(QVariantMap &message);
+
+    QString processMessageText(const QString &text);
 
     QHash<int, QByteArray> roleNames() const;
 
@@ -100,9 +156,33 @@ private:
 
     quint32 m_historyId;
 
+    bool m_loaded;
+
+    quint32 m_windowBegin;
+
+    quint32 m_numMessagesTotal;
+
+    quint32 m_windowSeq;
+
+    bool m_loadingOlder;
+
+    bool m_loadingNewer;
+
     QVariantList m_items;
 
     QMap<uint32_t, uint32_t> m_indexes;
+
+    mutable QHash<quint32, Message$> m_pendingResources;
+
+    mutable QHash<quint32, QVariantList> m_resources;
+
+    mutable QMutex m_resourcesMutex;
+
+    QHash<quint32, TextLayout> m_textCache;
+
+    QMutex m_textCacheMutex;
+
+    qreal m_fontPixelSize;
 };
 
 // ============================================================ //
@@ -31,8 +31,12 @@
 #define LOCALSTOREMODEL_H
 
 #include <QAbstractListModel>
+#include <QThreadPool>
+#include <QMutex>
 #include <QJSValue>
 
+#include "vfsnamecache.h"
+
 class BackendBase;
 
 // ============================================================ //
@@ -52,9 +56,27 @@ public:
         TypeRole,
         NameRole,
         SizeRole,
+        MediaTypeRole,
         OriginRole,
     };
 
+    class ImportItem
+    {
+    public:
+
+        QString m_path;
+
+        std::string m_name;
+
+        uint64_t m_parent = 0;
+
+        uint64_t m_size = 0;
+
+        uint64_t m_blobId = 0;
+
+        std::string m_hash;
+    };
+
     explicit LocalStoreModel(BackendBase *backend);
 
     int rowCount(const QModelIndex & parent = QModelIndex()) const;
@@ -73,24 +95,82 @@ public:
 
     Q_INVOKABLE void clear();
 
+    Q_INVOKABLE void setMediaFilter(qint32 mediaType);
+
+    Q_INVOKABLE void detectMediaType(qint32 index, const QJSValue &callback = QJSValue());
+
+    Q_INVOKABLE void setImportChunkSize(quint32 chunkSize);
+
+    Q_INVOKABLE void setDeleteProgressInterval(quint32 interval);
+
     Q_INVOKABLE void createDirectory(const QString &name, quint32 parent, const QJSValue &callback = QJSValue());
 
     Q_INVOKABLE void deleteItems(const QVariantList &items, const QJSValue &callback = QJSValue());
 
+    Q_INVOKABLE void cancelDelete();
+
+    void resumeDelete();
+
     Q_INVOKABLE void pasteFromFileSystem(const QVariantList &items, quint32 parent, const QJSValue &callback = QJSValue());
 
     Q_INVOKABLE void pasteFromLocalStore(const QVariantList &items, quint32 parent, const QJSValue &callback = QJSValue());
 
+signals:
+
+    void numItemsTotalChanged();
+
+    void updateDir(quint32 seq, quint32 numDirs, quint32 numFiles);
+
+    void insertItems(quint32 seq, qint32 offset, const QVariantList &items, quint32 next);
+
+    void deleteProgress(quint32 numDeleted, quint32 numPending, bool finished);
+
+    void dirSize(quint32 seq, quint32 dirId, quint64 size, quint32 numItems);
+
+    void mediaTypeDetected(quint32 seq, qint32 index, quint32 id, qint32 mediaType, const QJSValue &callback);
+
+    void importProgress(quint32 filesDone, quint32 filesTotal, quint64 bytesDone, quint64 bytesTotal, double bytesPerSecond);
+
+public slots:
+
+    void onUpdateDir(quint32 seq, quint32 numDirs, quint32 numFiles);
+
+    void onInsertItems(quint32 seq, qint32 offset, const QVariantList &items, quint32 next);
+
+    void onDirSize(quint32 seq, quint32 dirId, quint64 size, quint32 numItems);
+
+    void onMediaTypeDetected(quint32 seq, qint32 index, quint32 id, qint32 mediaType, const QJSValue &callback);
+
 private:
 
-    bool copyFile(const QString &src, uint64_t dst);
+    void loadPage();
 
-    bool copyDirectory(const QString &src, uint64_t dst, bool recursive = true);
+    static void invokeCallbacks(QList<QJSValue> &callbacks, qint32 numItems);
 
+    QVariantList queryItems(quint32 dir, quint32 numDirs, qint32 offset, qint32 limit, bool mediaTypes = false);
 
-    bool copyResource(uint64_t src, uint64_t dst);
+    void aggregateDirs(quint32 seq, const QVariantList &items);
 
-    bool copyDirectory(uint64_t src, uint64_t dst, bool recursive = true);
+    QVariantList filterItems(quint32 dir, quint32 numDirs, quint32 numEntries, quint32 &offset, qint32 limit, qint32 mediaType);
+
+
+    bool importTree(const QStringList &paths, uint64_t dst);
+
+    bool importFile(ImportItem &item);
+
+
+    bool detachNode(uint64_t id);
+
+    void reclaimNodes();
+
+
+    bool copyResource(uint64_t src, uint64_t dst, VfsNameCache &names);
+
+    bool copyNode(UBJ::Object &node, uint64_t dst, VfsNameCache &names);
+
+    bool copyDirectory(uint64_t src, uint64_t dst, VfsNameCache &names, bool recursive = true);
+
+    bool isAncestor(uint64_t ancestor, uint64_t id);
 
 
     QHash<int, QByteArray> roleNames() const;
@@ -103,7 +183,41 @@ private:
 
     quint32 m_numItemsTotal;
 
-    QList<QVariantMap> m_itemsFull;
+    quint32 m_numDirs;
+
+    quint32 m_numEntries;
+
+    quint32 m_offset;
+
+    qint32 m_mediaFilter;
+
+    quint32 m_seq;
+
+    bool m_loading;
+
+    qint32 m_pendingItems;
+
+    QList<QJSValue> m_pendingCallbacks;
+
+    QList<QJSValue> m_loadingCallbacks;
+
+    quint32 m_importChunkSize;
+
+    quint32 m_deleteProgressInterval;
+
+    QThreadPool m_importPool;
+
+    QThreadPool m_sizePool;
+
+    QAtomicInt m_sizeSeq;
+
+    QMutex m_deleteMutex;
+
+    bool m_deletePending;
+
+    bool m_deleteRunning;
+
+    QAtomicInt m_deleteCancelled;
 
     QList<QVariantMap> m_items;
 };
@@ -0,0 +1,104 @@
+
+// ============================================================ //
+//
+//   d88888D db   d8b   db  .d8b.  db    db
+//   YP  d8' 88   I8I   88 d8' `8b `8b  d8'
+//      d8'  88   I8I   88 88ooo88  `8bd8'
+//     d8'   Y8   I8I   88 88~~~88    88
+//    d8' db `8b d8'8b d8' 88   88    88
+//   d88888P  `8b8' `8d8'  YP   YP    YP
+//
+//   open-source, cross-platform, crypto-messenger
+//
+//   Copyright (C) 2018 Marc Weiler
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program. If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================ //
+
+#ifndef MEDIATYPES_H
+#define MEDIATYPES_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include <Zway/store.h>
+
+using namespace Zway;
+
+// ============================================================ //
+
+/**
+ * @brief The MediaTypes class
+ *
+ * Detects the media type of a file or store blob from its first bytes
+ * and caches the result, so the browser models can tell images, videos
+ * and audio apart without decoding anything.
+ */
+
+class MediaTypes
+{
+public:
+
+    enum {
+        Unknown = 0,
+        Image,
+        Video,
+        Audio,
+        Other
+    };
+
+    MediaTypes();
+
+    void clear();
+
+    qint32 fromFile(const QString &path, qint64 size, qint64 time);
+
+    qint32 fromBlob(Store$ store, uint64_t blobId, const std::string &hash);
+
+    static qint32 detect(const uint8_t *data, size_t size, uint64_t totalSize);
+
+private:
+
+    class FileEntry
+    {
+    public:
+
+        qint64 m_size = 0;
+
+        qint64 m_time = 0;
+
+        qint32 m_type = Unknown;
+    };
+
+    class BlobEntry
+    {
+    public:
+
+        std::string m_hash;
+
+        qint32 m_type = Unknown;
+    };
+
+    QHash<QString, FileEntry> m_files;
+
+    QHash<uint64_t, BlobEntry> m_blobs;
+
+    QMutex m_mutex;
+};
+
+// ============================================================ //
+
+#endif // MEDIATYPES_H
@@ -0,0 +1,134 @@
+
+// ============================================================ //
+//
+//   d88888D db   d8b   db  .d8b.  db    db
+//   YP  d8' 88   I8I   88 d8' `8b `8b  d8'
+//      d8'  88   I8I   88 88ooo88  `8bd8'
+//     d8'   Y8   I8I   88 88~~~88    88
+//    d8' db `8b d8'8b d8' 88   88    88
+//   d88888P  `8b8' `8d8'  YP   YP    YP
+//
+//   open-source, cross-platform, crypto-messenger
+//
+//   Copyright (C) 2018 Marc Weiler
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program. If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================ //
+
+#ifndef MESSAGEINDEX_H
+#define MESSAGEINDEX_H
+
+#include <QMap>
+#include <QHash>
+#include <QVector>
+#include <QMutex>
+#include <QStringList>
+
+// ============================================================ //
+
+/**
+ * @brief The MessageIndex class
+ *
+ * In-memory inverted index over message texts. Every message gets a
+ * sequential entry number, so posting lists stay sorted by insertion
+ * and can be intersected with a linear merge.
+ */
+
+class MessageIndex
+{
+public:
+
+    class Entry
+    {
+    public:
+
+        quint32 m_messageId = 0;
+
+        quint32 m_historyId = 0;
+
+        quint32 m_contactId = 0;
+
+        quint32 m_index = 0;
+
+        quint64 m_time = 0;
+
+        QString m_excerpt;
+
+        bool m_removed = false;
+    };
+
+    MessageIndex();
+
+    void clear();
+
+    void beginBuild();
+
+    void finishBuild();
+
+    void addMessage(quint32 messageId, quint32 historyId, quint32 contactId, quint64 time, const QString &text);
+
+    void queueMessage(quint32 messageId, quint32 historyId, quint32 contactId, quint64 time, const QString &text);
+
+    void removeHistory(quint32 historyId);
+
+    QList<Entry> search(const QString &query, quint32 contactId = 0, quint32 limit = 50);
+
+    quint32 numMessages();
+
+    static QStringList tokenize(const QString &text);
+
+    static QString plainText(const QString &text);
+
+private:
+
+    class Pending
+    {
+    public:
+
+        quint32 m_messageId;
+
+        quint32 m_historyId;
+
+        quint32 m_contactId;
+
+        quint64 m_time;
+
+        QString m_text;
+    };
+
+    void insertEntry(const Pending &message, const QStringList &tokens, const QString &excerpt);
+
+    QVector<quint32> postings(const QString &token, bool prefix);
+
+private:
+
+    QVector<Entry> m_entries;
+
+    QMap<QString, QVector<quint32>> m_postings;
+
+    QHash<quint32, quint32> m_messages;
+
+    QHash<quint32, quint32> m_historySizes;
+
+    QList<Pending> m_queued;
+
+    bool m_building;
+
+    QMutex m_mutex;
+};
+
+// ============================================================ //
+
+#endif // MESSAGEINDEX_H
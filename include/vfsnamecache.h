@@ -0,0 +1,80 @@
+
+// ============================================================ //
+//
+//   d88888D db   d8b   db  .d8b.  db    db
+//   YP  d8' 88   I8I   88 d8' `8b `8b  d8'
+//      d8'  88   I8I   88 88ooo88  `8bd8'
+//     d8'   Y8   I8I   88 88~~~88    88
+//    d8' db `8b d8'8b d8' 88   88    88
+//   d88888P  `8b8' `8d8'  YP   YP    YP
+//
+//   open-source, cross-platform, crypto-messenger
+//
+//   Copyright (C) 2018 Marc Weiler
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program. If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================ //
+
+#ifndef VFSNAMECACHE_H
+#define VFSNAMECACHE_H
+
+#include <QHash>
+#include <QString>
+
+#include <Zway/store.h>
+
+using namespace Zway;
+
+// ============================================================ //
+
+/**
+ * @brief The VfsNameCache class
+ *
+ * Caches the names below the directories a bulk operation touches. They
+ * are loaded with one query per directory, so collision checks don't hit
+ * the store once per node. Nodes are created through the cache so it
+ * stays current.
+ */
+
+class VfsNameCache
+{
+public:
+
+    VfsNameCache(Store$ store);
+
+    bool exists(uint64_t parent, const std::string &name, qint32 type = -1);
+
+    uint64_t createDirectory(const std::string &name, uint64_t parent);
+
+    bool addNode(qint32 type, const std::string &name, uint64_t parent, const UBJ::Object &data = UBJ::Object());
+
+    quint32 numNodes() const;
+
+private:
+
+    QHash<QString, qint32> &children(uint64_t parent);
+
+private:
+
+    Store$ m_store;
+
+    quint32 m_numNodes;
+
+    QHash<uint64_t, QHash<QString, qint32>> m_children;
+};
+
+// ============================================================ //
+
+#endif
@@ -48,6 +48,11 @@ Item {
         opacity = 1;
     }
 
+    function setText(text) {
+
+        statusText.text = text;
+    }
+
     function hide() {
 
         opacity = 0;
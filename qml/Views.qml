@@ -46,49 +46,13 @@ Controls.SwipeArea {
             }
         });
 
-        backend.contactRequest.connect(function() {
-
-            if (contactView.visible && actionBarState !== "search") {
-
-                contactModel.updateItems();
-            }
-        });
-
-        backend.contactRequestAccepted.connect(function() {
-
-            if (contactView.visible && actionBarState !== "search") {
-
-                contactModel.updateItems();
-            }
-        });
-
-        backend.contactRequestRejected.connect(function() {
-
-            if (contactView.visible && actionBarState !== "search") {
-
-                contactModel.updateItems();
-            }
-        });
-
-        backend.contactStatusChanged.connect(function() {
-
-            if (contactView.visible && actionBarState !== "search") {
-
-                contactModel.updateItems();
-            }
-        });
-
         backend.messageIncoming.connect(function(message) {
 
             if (!(historyView.visible && historyView.contact && historyView.contact.id === message.src)) {
 
-                if (backend.updateInbox(message.src, message.id)) {
-
-                    if (contactView.visible && actionBarState !== "search") {
+                // contact model picks up the new count via inboxChanged
 
-                        contactModel.updateItems();
-                    }
-                }
+                backend.updateInbox(message.src, message.id);
             }
         });
 
@@ -303,6 +267,16 @@ Controls.SwipeArea {
                 font.pixelSize: 14 * sp
                 visible: false
 
+                // filter local items while typing, return searches online
+
+                onTextChanged: {
+
+                    if (visible && viewSwitcher.currentView.filter) {
+
+                        viewSwitcher.currentView.filter(text.trim());
+                    }
+                }
+
                 Keys.onReturnPressed: search()
             }
 
@@ -358,6 +332,13 @@ Controls.SwipeArea {
                     visible: false
                     onClicked: search()
                 }
+
+                ActionButton {
+                    id: mediaFilterButton
+                    image: "/res/icons/" + dpiPrefix + "/ic_filter_list_white.png"
+                    visible: false
+                    onClicked: contentView.pickMediaFilter()
+                }
             }
 
             ActionButton {
@@ -591,6 +572,7 @@ Controls.SwipeArea {
             PropertyChanges { target: contactNameBox; visible: true }
             PropertyChanges { target: storeActionsGroup; visible: false }
             PropertyChanges { target: deleteButton; visible: true }
+            PropertyChanges { target: searchButton; visible: true }
             PropertyChanges { target: historyView; visible: true; focus: true }
         },
         State {
@@ -598,6 +580,7 @@ Controls.SwipeArea {
             PropertyChanges { target: chatActionsGroup; visible: false }
             PropertyChanges { target: storeActionsGroup; visible: true }
             PropertyChanges { target: addButton; visible: true }
+            PropertyChanges { target: mediaFilterButton; visible: true }
             PropertyChanges { target: contentView; visible: true; focus: true }
             PropertyChanges { target: actionBar; state: contentView.callback ? "content_callback" : "" }
         },
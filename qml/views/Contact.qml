@@ -158,6 +158,11 @@ Item {
         }
     }
 
+    function filter(what) {
+
+        contactModel.setFilter(what);
+    }
+
     function onItemClicked(index) {
 
         var item = contactModel.get(index);
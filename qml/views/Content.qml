@@ -61,6 +61,29 @@ Item {
         }
     ];
 
+    property var mediaFilterActions: [
+        {
+            actionId : 0,
+            image : "/res/icons/" + dpiPrefix + "/ic_sd_storage_black.png",
+            label : "All Files"
+        },
+        {
+            actionId : 1,
+            image : "/res/icons/" + dpiPrefix + "/file_image.png",
+            label : "Images"
+        },
+        {
+            actionId : 2,
+            image : "/res/icons/" + dpiPrefix + "/file_video.png",
+            label : "Videos"
+        },
+        {
+            actionId : 3,
+            image : "/res/icons/" + dpiPrefix + "/file_audio.png",
+            label : "Audio"
+        }
+    ];
+
 
     Component.onCompleted: {
 
@@ -93,6 +116,33 @@ Item {
                 breadcrumbs: new Utils.BreadcrumbsHelper()
             }
         };
+
+        // both models list directories in the background
+
+        localStoreModel.numItemsTotalChanged.connect(function() {
+
+            if (activeModel === localStoreModel) {
+
+                browser.numItemsTotal = localStoreModel.numItemsTotal();
+            }
+        });
+
+        fileSystemModel.numItemsTotalChanged.connect(function() {
+
+            if (activeModel === fileSystemModel) {
+
+                browser.numItemsTotal = fileSystemModel.numItemsTotal();
+            }
+        });
+
+        localStoreModel.importProgress.connect(showProgress);
+
+        fileSystemModel.copyProgress.connect(showProgress);
+    }
+
+    function showProgress(filesDone, filesTotal, bytesDone, bytesTotal, bytesPerSecond) {
+
+        busyBox.setText(filesDone + " / " + filesTotal + " files, " + (bytesPerSecond / (1024 * 1024)).toFixed(1) + " MB/s");
     }
 
     function addItem() {
@@ -237,6 +287,25 @@ Item {
         activeModel.moreItems(browser.numItemsPage * 2, cwd);
     }
 
+    function pickMediaFilter() {
+
+        actionPicker.show(mediaFilterActions, function(actionId) {
+
+            setMediaFilter(actionId);
+        });
+    }
+
+    function setMediaFilter(mediaType) {
+
+        // 0 shows everything, otherwise only directories and files of that media type
+
+        fileSystemModel.setMediaFilter(mediaType);
+
+        localStoreModel.setMediaFilter(mediaType);
+
+        browser.cd(activeModel.currentDir());
+    }
+
     function toggleSelection(index) {
 
         var itemData = activeModel.getItemData(index);
@@ -355,27 +424,46 @@ Item {
 
                 if (itemData) {
 
-                    if (Utils.ImageFileRex.test(itemData.name)) {
+                    // file rows learn their media type once they are shown
 
-                        var url = itemData.id + "?blobId=" + itemData.data + "&thumbSize=" + parseInt(browser.tileSize / dp) + "&source=" + mode + "&cache=1&async=1";
+                    if (activeModel.detectMediaType && itemData.type === 2 && itemData.mediaType === 0) {
 
-                        ImageService.loadImage(url, itemData, function(err, url, data) {
+                        activeModel.detectMediaType(index, function(mediaType) {
 
-                            if (!err) {
-
-                                item.image.source = "image://thumbs/" + url;
-                            }
+                            itemData.mediaType = mediaType;
 
-                            done(index);
+                            loadThumbnail(index, item, itemData, done);
                         });
                     }
                     else {
 
-                        done(index);
+                        loadThumbnail(index, item, itemData, done);
                     }
                 }
             }
 
+            function loadThumbnail(index, item, itemData, done) {
+
+                if (itemData.mediaType === 1) {
+
+                    var url = itemData.id + "?blobId=" + itemData.data + "&thumbSize=" + parseInt(browser.tileSize / dp) + "&source=" + mode + "&cache=1&async=1";
+
+                    ImageService.loadImage(url, itemData, function(err, url, data) {
+
+                        if (!err) {
+
+                            item.image.source = "image://thumbs/" + url;
+                        }
+
+                        done(index);
+                    });
+                }
+                else {
+
+                    done(index);
+                }
+            }
+
             function cd(dir, model) {
 
                 if (model) {
@@ -444,17 +532,17 @@ x
                                 "/res/icons/" + dpiPrefix + "/ic_folder_grey.png";
                             }
                             else
-                            if (type === 2 && Utils.ImageFileRex.test(name)) {
+                            if (type === 2 && mediaType === 1) {
 
                                 "/res/icons/" + dpiPrefix + "/file_image.png";
                             }
                             else
-                            if (type === 2 && Utils.AudioFileRex.test(name)) {
+                            if (type === 2 && mediaType === 3) {
 
                                 "/res/icons/" + dpiPrefix + "/file_audio.png";
                             }
                             else
-                            if (type === 2 && Utils.VideoFileRex.test(name)) {
+                            if (type === 2 && mediaType === 2) {
 
                                 "/res/icons/" + dpiPrefix + "/file_video.png";
                             }
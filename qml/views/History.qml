@@ -171,13 +171,142 @@ Item {
             historyView.model = model;
 
             views.state = "history";
+
+            if (!model.loaded()) {
+
+                // rows were released by the backend, reload them
+
+                busyBox.show("", function() {
+
+                    model.updateItems(function() {
+
+                        busyBox.hide();
+                    });
+                });
+            }
+            else {
+
+                backend.touchHistoryModel(model.historyId());
+            }
+        }
+
+        backend.resetInbox(contactId);
+    }
+
+    function search(what) {
+
+        if (!what || !contact) {
+
+            return;
+        }
+
+        var hits = backend.searchMessages(what, contact.id, 50);
+
+        if (!hits.length) {
+
+            status.show("No messages found");
+
+            return;
+        }
+
+        var actions = [];
+
+        for (var i = 0; i < hits.length; ++i) {
+
+            actions.push({
+                actionId : i,
+                image    : "/res/icons/" + dpiPrefix + "/ic_message_black.png",
+                label    : hits[i].text || ""
+            });
+        }
+
+        actionPicker.show(actions, function(actionId) {
+
+            var hit = hits[actionId];
+
+            views.actionBarState = "";
+
+            showMessage(hit.contactId, hit.messageId, hit.historyId);
+        });
+    }
+
+    function showMessage(contactId, messageId, historyId) {
+
+        var model = models[contactId];
+
+        var created = !model;
+
+        // hits in older histories get their own model, the cache only holds the latest one
+
+        if (historyId && historyId !== backend.latestHistoryId(contactId)) {
+
+            model = backend.historyModel(historyId);
+
+            created = true;
+        }
+        else
+        if (created) {
+
+            model = backend.latestHistoryModel(contactId);
+
+            if (model) {
+
+                models[contactId] = model;
+            }
+        }
+
+        if (!model) {
+
+            return;
         }
 
+        historyView.contact = backend.getContact(contactId);
+
+        historyView.model = model;
+
+        views.state = "history";
+
         backend.resetInbox(contactId);
+
+        var row = model.loaded() ? model.messageRow(messageId) : -1;
+
+        if (row !== -1) {
+
+            listView.positionViewAtIndex(row, ListView.Center);
+
+            return;
+        }
+
+        // load only the page around the message
+
+        busyBox.show("", function() {
+
+            model.loadAround(messageId, 50, function(row) {
+
+                busyBox.hide();
+
+                if (created) {
+
+                    clearMessage();
+                }
+
+                if (row !== -1) {
+
+                    listView.positionViewAtIndex(row, ListView.Center);
+                }
+            });
+        });
     }
 
     function goBack() {
 
+        if (views.actionBarState === "search") {
+
+            views.actionBarState = "";
+
+            return true;
+        }
+
         contactView.show();
 
         return true;
@@ -404,7 +533,7 @@ Item {
         Row {
             id: row
 
-            property real textWidth: 0
+            property real textWidth: messageTextWidth
 
             readonly property bool ownMessage: messageSrc === backend.accountId()
 
@@ -458,9 +587,9 @@ Item {
                             width: row.textWidth > listView.width - listView.messageWrapLeftOffset ? listView.width - listView.messageWrapLeftOffset : row.textWidth
                             wrapMode: row.textWidth > listView.width - listView.messageWrapLeftOffset ? Text.Wrap : Text.NoWrap
                             textFormat: Text.RichText
-                            text: processMessageText(messageText)
+                            text: messageDisplayText
                             font.pixelSize: theme.HistoryView.Message.fontSize * sp
-                            onTextChanged: textWidth = text1.paintedWidth
+                            onTextChanged: textWidth = messageTextWidth || text1.paintedWidth
                             onLinkActivated: {
 
                                 if (link.indexOf("http") === 0) {
@@ -505,7 +634,7 @@ Item {
                 }
             }
 
-            Component.onCompleted: textWidth = text1.paintedWidth
+            Component.onCompleted: if (!textWidth) textWidth = text1.paintedWidth
         }
     }
 
@@ -529,6 +658,24 @@ Item {
         boundsBehavior: ListView.DragOverBounds
         verticalLayoutDirection: ListView.BottomToTop
         delegate: listViewDelegate
+
+        // extend a partially loaded history while scrolling
+
+        onAtYBeginningChanged: {
+
+            if (atYBeginning && model && model.hasOlder()) {
+
+                model.moreItems(50, true);
+            }
+        }
+
+        onAtYEndChanged: {
+
+            if (atYEnd && model && model.hasNewer()) {
+
+                model.moreItems(50, false);
+            }
+        }
     }
 
     Item {
@@ -150,9 +150,7 @@ void Backend::onEvent(CLIENT client, EVENT event)
 
         UBJ::Object resource = event->data()["resource"];
 
-        processResourceRecv(message, resource);
-
-        emit resourceReceived(ubjToJsonObj(message), ubjToJsonObj(resource));
+        receiveResource(message, resource);
 
         break;
     }
@@ -72,7 +72,8 @@ BackendBase::BackendBase(QGuiApplication *app, QQmlEngine *engine)
       m_active(true),
       m_contactModel(this),
       m_fileSystemModel(this),
-      m_localStoreModel(this)
+      m_localStoreModel(this),
+      m_historyRowBudget(10000)
 {
     m_instance = this;
 
@@ -112,6 +113,10 @@ BackendBase::BackendBase(QGuiApplication *app, QQmlEngine *engine)
 
 #endif
 
+    // received resources are hashed one after the other, in the order they arrive
+
+    m_resourcePool.setMaxThreadCount(1);
+
     QQmlContext* context = m_engine->rootContext();
 
     context->setContextProperty(QStringLiteral("dpiPrefix"), dpiPrefix);
@@ -133,7 +138,9 @@ BackendBase::BackendBase(QGuiApplication *app, QQmlEngine *engine)
 
     if (doc.isObject()) {
 
-        context->setContextProperty("theme", doc.object());
+        m_theme = doc.object();
+
+        context->setContextProperty("theme", m_theme);
     }
 
 
@@ -144,6 +151,12 @@ BackendBase::BackendBase(QGuiApplication *app, QQmlEngine *engine)
 
     QObject::connect(this, &BackendBase::invokeCallback, this, &BackendBase::onInvokeCallback);
 
+    QObject::connect(this, &BackendBase::storeUnlocked, this, &BackendBase::onStoreUnlocked);
+
+    QObject::connect(this, &BackendBase::messageIncoming, this, &BackendBase::onMessage);
+
+    QObject::connect(this, &BackendBase::messageOutgoing, this, &BackendBase::onMessage);
+
 }
 
 /**
@@ -264,6 +277,14 @@ void BackendBase::onEvent(Client$ client, Event$ event)
 
     case Event::Disconnected:
 
+        {
+            QMutexLocker locker(&m_contactStatusesMutex);
+
+            m_contactStatuses.clear();
+        }
+
+        emit contactStatusesChanged();
+
         emit disconnected();
 
         break;
@@ -296,11 +317,52 @@ void BackendBase::onEvent(Client$ client, Event$ event)
         break;
     }
 
-    case Event::ContactStatus:
+    case Event::ContactStatus: {
+
+        // only a complete, numeric payload updates a single row
+
+        QJsonObject data = ubjToJsonObj(event->data());
+
+        QJsonValue contactIdVal = data["contactId"];
+
+        QJsonValue statusVal = data["status"];
+
+        if (contactIdVal.isDouble() && statusVal.isDouble() && contactIdVal.toDouble() > 0) {
+
+            quint32 contactId = contactIdVal.toVariant().toUInt();
+
+            qint32 status = statusVal.toInt();
+
+            {
+                QMutexLocker locker(&m_contactStatusesMutex);
+
+                auto it = m_contactStatuses.find(contactId);
 
-        emit contactStatusChanged();
+                if (it != m_contactStatuses.end() && *it == status) {
+
+                    break;
+                }
+
+                m_contactStatuses[contactId] = status;
+            }
+
+            emit contactStatusChanged(contactId, status);
+        }
+        else {
+
+            // no or a malformed payload, every cached status may be outdated
+
+            {
+                QMutexLocker locker(&m_contactStatusesMutex);
+
+                m_contactStatuses.clear();
+            }
+
+            emit contactStatusesChanged();
+        }
 
         break;
+    }
 
     case Event::MessageIncoming: {
 
@@ -353,9 +415,7 @@ void BackendBase::onEvent(Client$ client, Event$ event)
 
         UBJ::Object resource = event->data()["resource"];
 
-        processResourceRecv(message, resource);
-
-        emit resourceReceived(ubjToJsonObj(message), ubjToJsonObj(resource));
+        receiveResource(message, resource);
 
         break;
     }
@@ -920,8 +980,17 @@ quint32 BackendBase::latestHistoryId(quint32 dst)
 
 QVariant BackendBase::latestHistoryModel(quint32 dst)
 {
-    uint32_t historyId = store()->latestHistory(dst);
+    return historyModel(store()->latestHistory(dst));
+}
 
+/**
+ * @brief BackendBase::historyModel
+ * @param historyId
+ * @return
+ */
+
+QVariant BackendBase::historyModel(quint32 historyId)
+{
     if (historyId) {
 
         if (m_historyModels.contains(historyId)) {
@@ -941,6 +1010,94 @@ QVariant BackendBase::latestHistoryModel(quint32 dst)
     return QVariant();
 }
 
+/**
+ * @brief BackendBase::touchHistoryModel
+ * @param historyId
+ */
+
+void BackendBase::touchHistoryModel(quint32 historyId)
+{
+    m_historyModelsLru.removeAll(historyId);
+
+    m_historyModelsLru.append(historyId);
+
+    evictHistoryModels();
+}
+
+/**
+ * @brief BackendBase::setHistoryRowBudget
+ * @param numRows
+ */
+
+void BackendBase::setHistoryRowBudget(quint32 numRows)
+{
+    m_historyRowBudget = numRows;
+
+    evictHistoryModels();
+}
+
+/**
+ * @brief BackendBase::historyModelStats
+ * @return
+ */
+
+QJsonObject BackendBase::historyModelStats()
+{
+    qint32 numLoaded = 0;
+
+    qint32 numRows = 0;
+
+    for (auto &model : m_historyModels) {
+
+        if (model->loaded()) {
+
+            numLoaded++;
+
+            numRows += model->rowCount();
+        }
+    }
+
+    return {
+        {"models"      , m_historyModels.size()},
+        {"loadedModels", numLoaded},
+        {"residentRows", numRows},
+        {"rowBudget"   , (qint32)m_historyRowBudget}
+    };
+}
+
+/**
+ * @brief BackendBase::evictHistoryModels
+ */
+
+void BackendBase::evictHistoryModels()
+{
+    quint32 numRows = 0;
+
+    for (auto &model : m_historyModels) {
+
+        if (model->loaded()) {
+
+            numRows += model->rowCount();
+        }
+    }
+
+    // release least recently used models, but always keep the current one
+
+    while (numRows > m_historyRowBudget && m_historyModelsLru.size() > 1) {
+
+        quint32 historyId = m_historyModelsLru.takeFirst();
+
+        if (m_historyModels.contains(historyId)) {
+
+            std::shared_ptr<HistoryModel> model = m_historyModels[historyId];
+
+            numRows -= model->rowCount();
+
+            model->release();
+        }
+    }
+}
+
 /**
  * @brief Backend::deleteRequest
  * @param id
@@ -973,6 +1130,8 @@ bool BackendBase::deleteHistory(quint32 id, const QJSValue &callback)
         if (store()->deleteHistory(id)) {
 
             m_historyModels.remove(id);
+
+            m_messageIndex.removeHistory(id);
         }
 
         emit invokeCallback(callback);
@@ -1008,7 +1167,20 @@ void BackendBase::deleteContact(quint32 id, const QJSValue &callback)
 
 quint32 BackendBase::updateInbox(quint32 contactId, quint32 messageId)
 {
-    return m_store->updateInbox(contactId, {messageId});
+    quint32 res = m_store->updateInbox(contactId, {messageId});
+
+    if (res) {
+
+        {
+            QMutexLocker locker(&m_inboxCountsMutex);
+
+            m_inboxCounts.remove(contactId);
+        }
+
+        emit inboxChanged(contactId, inboxCounts({contactId})[contactId]);
+    }
+
+    return res;
 }
 
 /**
@@ -1019,6 +1191,160 @@ quint32 BackendBase::updateInbox(quint32 contactId, quint32 messageId)
 void BackendBase::resetInbox(quint32 contactId)
 {
     m_store->resetInbox(contactId);
+
+    {
+        QMutexLocker locker(&m_inboxCountsMutex);
+
+        m_inboxCounts[contactId] = 0;
+    }
+
+    emit inboxChanged(contactId, 0);
+}
+
+/**
+ * @brief BackendBase::inboxCounts
+ * @param contactIds
+ * @return
+ */
+
+QHash<quint32, quint32> BackendBase::inboxCounts(const QList<quint32> &contactIds)
+{
+    // counts are cached and only refetched for contacts whose inbox changed
+
+    QHash<quint32, quint32> res;
+
+    QList<quint32> missing;
+
+    {
+        QMutexLocker locker(&m_inboxCountsMutex);
+
+        for (auto contactId : contactIds) {
+
+            auto it = m_inboxCounts.find(contactId);
+
+            if (it != m_inboxCounts.end()) {
+
+                res[contactId] = *it;
+            }
+            else {
+
+                missing.append(contactId);
+            }
+        }
+    }
+
+    if (missing.empty()) {
+
+        return res;
+    }
+
+    // a single contact is counted directly, more are counted from one scan of the inbox
+
+    QHash<quint32, quint32> counts;
+
+    if (missing.size() == 1) {
+
+        counts[missing.first()] = store()->numInboxMessages(missing.first());
+    }
+    else {
+
+        std::list<UBJ::Object> entries;
+
+        store()->query("inbox", {}, entries, {}, {"contactId"});
+
+        for (auto &entry : entries) {
+
+            counts[entry["contactId"].toInt()]++;
+        }
+    }
+
+    QMutexLocker locker(&m_inboxCountsMutex);
+
+    for (auto contactId : missing) {
+
+        res[contactId] = counts.value(contactId);
+
+        m_inboxCounts[contactId] = res[contactId];
+    }
+
+    return res;
+}
+
+/**
+ * @brief BackendBase::contactStatuses
+ * @param contactIds
+ * @return
+ */
+
+QHash<quint32, qint32> BackendBase::contactStatuses(const QList<quint32> &contactIds)
+{
+    QMutexLocker locker(&m_contactStatusesMutex);
+
+    // the table follows status events, the client is only asked for unknown contacts
+
+    QHash<quint32, qint32> res;
+
+    for (auto contactId : contactIds) {
+
+        auto it = m_contactStatuses.find(contactId);
+
+        if (it == m_contactStatuses.end()) {
+
+            it = m_contactStatuses.insert(contactId, (qint32)contactStatus(contactId));
+        }
+
+        res[contactId] = *it;
+    }
+
+    return res;
+}
+
+/**
+ * @brief BackendBase::contactStatusTable
+ * @return
+ */
+
+QVariantMap BackendBase::contactStatusTable()
+{
+    QMutexLocker locker(&m_contactStatusesMutex);
+
+    QVariantMap res;
+
+    for (auto it = m_contactStatuses.begin(); it != m_contactStatuses.end(); ++it) {
+
+        res[QString::number(it.key())] = it.value();
+    }
+
+    return res;
+}
+
+/**
+ * @brief BackendBase::searchMessages
+ * @param query
+ * @param contactId
+ * @param limit
+ * @return
+ */
+
+QVariantList BackendBase::searchMessages(const QString &query, quint32 contactId, quint32 limit)
+{
+    QVariantList res;
+
+    for (auto &entry : m_messageIndex.search(query, contactId, limit)) {
+
+        QVariantMap hit;
+
+        hit["messageId"] = entry.m_messageId;
+        hit["historyId"] = entry.m_historyId;
+        hit["contactId"] = entry.m_contactId;
+        hit["index"]     = entry.m_index;
+        hit["time"]      = entry.m_time;
+        hit["text"]      = entry.m_excerpt;
+
+        res.append(hit);
+    }
+
+    return res;
 }
 
 /**
@@ -1065,6 +1391,24 @@ bool BackendBase::processDispatchRequest(const UBJ::Object &args, RequestCallbac
     }));
 }
 
+/**
+ * @brief BackendBase::receiveResource
+ * @param message
+ * @param resource
+ */
+
+void BackendBase::receiveResource(const UBJ::Object &message, const UBJ::Object &resource)
+{
+    // hashing a large blob would hold up every other event, the view learns about it once it is stored
+
+    m_resourcePool.start(new LambdaRunnable([this, message, resource] () mutable {
+
+        processResourceRecv(message, resource);
+
+        emit resourceReceived(ubjToJsonObj(message), ubjToJsonObj(resource));
+    }));
+}
+
 /**
  * @brief BackendBase::processResourceRecv
  * @param message
@@ -1110,6 +1454,60 @@ bool BackendBase::processResourceRecv(UBJ::Object &message, UBJ::Object &resourc
 
     if (blobId) {
 
+        // the sender's hash is only a claim, dedup relies on the hash of what was actually received
+
+        std::string claimed = resource["hash"].toStr();
+
+        uint64_t size = 0;
+
+        std::string hash = BlobIndex::hashBlob(store(), blobId, size);
+
+        if (hash.empty()) {
+
+            // unreadable, kept as a plain blob with the sender's hash as the only one known
+
+            size = resource["size"].toLong();
+
+            hash = claimed;
+
+            blobIndex().addRef(blobId, std::string(), size);
+        }
+        else
+        if (BlobIndex::isContentHash(claimed) && (claimed != hash || size != (uint64_t)resource["size"].toLong())) {
+
+            // a claim of the same format which does not fit is kept as a plain blob, no existing blob is reused
+
+            blobIndex().addRef(blobId, std::string(), size);
+        }
+        else {
+
+            // a matching claim or one of another format, the local hash decides,
+            // reuse a blob with the same content and free the received copy
+
+            uint64_t existingId = blobIndex().acquire(hash, size);
+
+            if (existingId && existingId != blobId) {
+
+                if (store()->remove("blob3", UBJ_OBJ("rowid" << blobId))) {
+
+                    blobId = existingId;
+
+                    resource["data"] = blobId;
+                }
+                else {
+
+                    blobIndex().release(existingId);
+
+                    blobIndex().addRef(blobId, hash, size);
+                }
+            }
+            else
+            if (!existingId) {
+
+                blobIndex().addRef(blobId, hash, size);
+            }
+        }
+
         // update message text
 
         QString text = message["text"].toStr().c_str();
@@ -1138,17 +1536,53 @@ bool BackendBase::processResourceRecv(UBJ::Object &message, UBJ::Object &resourc
                         "parent" << incDir <<
                         "time"   << (uint64_t)time(nullptr) <<
                         "name"   << resource["name"] <<
-                        "size"   << resource["size"] <<
-                        "hash"   << resource["hash"] <<
+                        "size"   << size <<
+                        "hash"   << hash <<
                         "data"   << blobId))) {
 
             return false;
         }
+
+        // ioDir may have created directories too, so the totals are recomputed
+
+        m_dirSizes.invalidate(store(), incDir);
     }
 
     return true;
 }
 
+/**
+ * @brief BackendBase::blobIndex
+ * @return
+ */
+
+BlobIndex &BackendBase::blobIndex()
+{
+    m_blobIndex.load(store());
+
+    return m_blobIndex;
+}
+
+/**
+ * @brief BackendBase::mediaTypes
+ * @return
+ */
+
+MediaTypes &BackendBase::mediaTypes()
+{
+    return m_mediaTypes;
+}
+
+/**
+ * @brief BackendBase::dirSizes
+ * @return
+ */
+
+DirSizes &BackendBase::dirSizes()
+{
+    return m_dirSizes;
+}
+
 /**
  * @brief BackendBase::jsonToUbj
  * @param val
@@ -1291,6 +1725,16 @@ QJsonArray BackendBase::ubjToJsonArr(const UBJ::Value &ubj)
     return arr;
 }
 
+/**
+ * @brief BackendBase::theme
+ * @return
+ */
+
+QJsonObject BackendBase::theme()
+{
+    return m_theme;
+}
+
 /**
  * @brief BackendBase::engine
  * @return
@@ -1342,6 +1786,84 @@ void BackendBase::onInvokeCallback(const QJSValue &callback, const QVariantList
     }
 }
 
+/**
+ * @brief BackendBase::onStoreUnlocked
+ */
+
+void BackendBase::onStoreUnlocked()
+{
+    // build message index in background
+
+    {
+        QMutexLocker locker(&m_inboxCountsMutex);
+
+        m_inboxCounts.clear();
+    }
+
+    {
+        QMutexLocker locker(&m_contactStatusesMutex);
+
+        m_contactStatuses.clear();
+    }
+
+    m_blobIndex.clear();
+
+    m_dirSizes.clear();
+
+    m_localStoreModel.resumeDelete();
+
+    m_messageIndex.beginBuild();
+
+    LambdaRunnable::start([this] {
+
+        // every history is indexed, oldest first, so hits in older ones can be shown too
+
+        std::list<UBJ::Object> histories;
+
+        store()->query("histories", {}, histories, UBJ_OBJ("id" << 1), {"id", "contactId"});
+
+        for (auto &history : histories) {
+
+            uint32_t historyId = history["id"].toInt();
+
+            uint32_t contactId = history["contactId"].toInt();
+
+            for (auto &message : store()->getMessages(historyId)) {
+
+                m_messageIndex.addMessage(
+                            message->id(),
+                            historyId,
+                            contactId,
+                            message->time(),
+                            QString::fromStdString(message->text()));
+            }
+        }
+
+        m_messageIndex.finishBuild();
+    });
+}
+
+/**
+ * @brief BackendBase::onMessage
+ * @param message
+ */
+
+void BackendBase::onMessage(const QJsonObject &message)
+{
+    quint32 src = message["src"].toVariant().toUInt();
+
+    quint32 dst = message["dst"].toVariant().toUInt();
+
+    quint32 contactId = src == accountId() ? dst : src;
+
+    m_messageIndex.queueMessage(
+                message["id"].toVariant().toUInt(),
+                store()->latestHistory(contactId),
+                contactId,
+                message["time"].toVariant().toULongLong(),
+                message["text"].toString());
+}
+
 // ============================================================ //
 
 /**
@@ -0,0 +1,337 @@
+
+// ============================================================ //
+//
+//   d88888D db   d8b   db  .d8b.  db    db
+//   YP  d8' 88   I8I   88 d8' `8b `8b  d8'
+//      d8'  88   I8I   88 88ooo88  `8bd8'
+//     d8'   Y8   I8I   88 88~~~88    88
+//    d8' db `8b d8'8b d8' 88   88    88
+//   d88888P  `8b8' `8d8'  YP   YP    YP
+//
+//   open-source, cross-platform, crypto-messenger
+//
+//   Copyright (C) 2018 Marc Weiler
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program. If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================ //
+
+#include "blobindex.h"
+
+#include <QCryptographicHash>
+
+#include <Zway/memorybuffer.h>
+#include <Zway/ubj/store/blob.h>
+
+// ============================================================ //
+
+/**
+ * @brief BlobIndex::BlobIndex
+ */
+
+BlobIndex::BlobIndex()
+    : m_loaded(false)
+{
+
+}
+
+/**
+ * @brief BlobIndex::clear
+ */
+
+void BlobIndex::clear()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_blobs.clear();
+
+    m_hashes.clear();
+
+    m_sizes.clear();
+
+    m_loaded = false;
+}
+
+/**
+ * @brief BlobIndex::load
+ * @param store
+ */
+
+void BlobIndex::load(Store$ store)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_loaded || !store) {
+
+        return;
+    }
+
+    std::list<UBJ::Object> nodes;
+
+    store->query("vfs", UBJ_OBJ("type" << Store::File), nodes, {}, {"data", "hash", "size"});
+
+    for (auto &node : nodes) {
+
+        uint64_t blobId = node["data"].toLong();
+
+        if (blobId) {
+
+            // nodes from before imports hashed with sha-256 keep the library's hash, they are counted but never matched
+
+            std::string hash = node["hash"].toStr();
+
+            addRefUnlocked(blobId, isContentHash(hash) ? QByteArray::fromStdString(hash) : QByteArray(), node["size"].toLong());
+        }
+    }
+
+    m_loaded = true;
+}
+
+/**
+ * @brief BlobIndex::hasSize
+ * @param size
+ * @return
+ */
+
+bool BlobIndex::hasSize(uint64_t size)
+{
+    QMutexLocker locker(&m_mutex);
+
+    return m_sizes.contains(size);
+}
+
+/**
+ * @brief BlobIndex::acquire
+ * @param hash
+ * @param size
+ * @return id of a blob with the same content, 0 if there is none
+ */
+
+uint64_t BlobIndex::acquire(const std::string &hash, uint64_t size)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (hash.empty()) {
+
+        return 0;
+    }
+
+    auto it = m_hashes.find(QByteArray::fromStdString(hash));
+
+    if (it == m_hashes.end()) {
+
+        return 0;
+    }
+
+    Entry &entry = m_blobs[*it];
+
+    if (entry.m_size != size) {
+
+        return 0;
+    }
+
+    entry.m_refs++;
+
+    return *it;
+}
+
+/**
+ * @brief BlobIndex::addRef
+ * @param blobId
+ * @param hash
+ * @param size
+ */
+
+void BlobIndex::addRef(uint64_t blobId, const std::string &hash, uint64_t size)
+{
+    QMutexLocker locker(&m_mutex);
+
+    addRefUnlocked(blobId, QByteArray::fromStdString(hash), size);
+}
+
+/**
+ * @brief BlobIndex::release
+ * @param blobId
+ * @return true if the last reference is gone and the blob can be freed
+ */
+
+bool BlobIndex::release(uint64_t blobId)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_blobs.find(blobId);
+
+    // unknown blobs are never reported as free
+
+    if (it == m_blobs.end()) {
+
+        return false;
+    }
+
+    if (--it->m_refs) {
+
+        return false;
+    }
+
+    if (!it->m_hash.isEmpty() && m_hashes.value(it->m_hash) == blobId) {
+
+        m_hashes.remove(it->m_hash);
+    }
+
+    auto size = m_sizes.find(it->m_size);
+
+    if (size != m_sizes.end() && !--(*size)) {
+
+        m_sizes.erase(size);
+    }
+
+    m_blobs.erase(it);
+
+    return true;
+}
+
+/**
+ * @brief BlobIndex::numRefs
+ * @param blobId
+ * @return
+ */
+
+quint32 BlobIndex::numRefs(uint64_t blobId)
+{
+    QMutexLocker locker(&m_mutex);
+
+    return m_blobs.value(blobId).m_refs;
+}
+
+/**
+ * @brief BlobIndex::addRefUnlocked
+ * @param blobId
+ * @param hash
+ * @param size
+ */
+
+void BlobIndex::addRefUnlocked(uint64_t blobId, const QByteArray &hash, uint64_t size)
+{
+    if (!blobId) {
+
+        return;
+    }
+
+    auto it = m_blobs.find(blobId);
+
+    if (it == m_blobs.end()) {
+
+        it = m_blobs.insert(blobId, Entry());
+
+        it->m_hash = hash;
+
+        it->m_size = size;
+
+        m_sizes[size]++;
+
+        if (!hash.isEmpty() && !m_hashes.contains(hash)) {
+
+            m_hashes[hash] = blobId;
+        }
+    }
+
+    it->m_refs++;
+}
+
+/**
+ * @brief BlobIndex::hashBlob
+ * @param store
+ * @param blobId
+ * @param size receives the size of the blob
+ * @return hex sha-256 of the blob content, empty if it could not be read
+ */
+
+std::string BlobIndex::hashBlob(Store$ store, uint64_t blobId, uint64_t &size)
+{
+    std::string res;
+
+    size = 0;
+
+    if (!store || !blobId) {
+
+        return res;
+    }
+
+    store->readBlob("blob3", blobId, [&] (bool error, UBJ::Store::Blob$ blob) {
+
+        if (error) {
+
+            return;
+        }
+
+        const uint32_t chunkSize = 1024 * 1024;
+
+        MemoryBuffer$ buf = MemoryBuffer::create(nullptr, chunkSize);
+
+        if (!buf) {
+
+            return;
+        }
+
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+
+        uint64_t blobSize = blob->size();
+
+        for (uint64_t offset = 0; offset < blobSize;) {
+
+            uint32_t numBytes = qMin<uint64_t>(chunkSize, blobSize - offset);
+
+            if (blob->read(buf, numBytes, offset) != numBytes) {
+
+                return;
+            }
+
+            hash.addData((const char*)buf->data(), numBytes);
+
+            offset += numBytes;
+        }
+
+        size = blobSize;
+
+        res = hash.result().toHex().toStdString();
+    });
+
+    return res;
+}
+
+/**
+ * @brief BlobIndex::isContentHash
+ * @param hash
+ * @return true if hash has the format hashBlob and imports produce, hex sha-256
+ */
+
+bool BlobIndex::isContentHash(const std::string &hash)
+{
+    if (hash.size() != 64) {
+
+        return false;
+    }
+
+    for (char c : hash) {
+
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ============================================================ //
@@ -0,0 +1,161 @@
+
+// ============================================================ //
+//
+//   d88888D db   d8b   db  .d8b.  db    db
+//   YP  d8' 88   I8I   88 d8' `8b `8b  d8'
+//      d8'  88   I8I   88 88ooo88  `8bd8'
+//     d8'   Y8   I8I   88 88~~~88    88
+//    d8' db `8b d8'8b d8' 88   88    88
+//   d88888P  `8b8' `8d8'  YP   YP    YP
+//
+//   open-source, cross-platform, crypto-messenger
+//
+//   Copyright (C) 2018 Marc Weiler
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "chunkpipe.h"
+
+// ============================================================ //
+
+/**
+ * @brief ChunkPipe::ChunkPipe
+ * @param handler called on the companion thread for every chunk
+ */
+
+ChunkPipe::ChunkPipe(Handler handler)
+    : m_handler(handler),
+      m_numBytes(0),
+      m_offset(0),
+      m_busy(false),
+      m_failed(false),
+      m_stop(false)
+{
+    m_thread = std::thread(&ChunkPipe::run, this);
+}
+
+/**
+ * @brief ChunkPipe::~ChunkPipe
+ */
+
+ChunkPipe::~ChunkPipe()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+
+        while (m_busy) {
+
+            m_cond.wait(&m_mutex);
+        }
+
+        m_stop = true;
+
+        m_cond.wakeAll();
+    }
+
+    m_thread.join();
+}
+
+/**
+ * @brief ChunkPipe::push
+ * @param buf
+ * @param numBytes
+ * @param offset
+ */
+
+void ChunkPipe::push(MemoryBuffer$ buf, uint32_t numBytes, uint64_t offset)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // one chunk in flight, the caller owns the other buffer
+
+    while (m_busy) {
+
+        m_cond.wait(&m_mutex);
+    }
+
+    if (m_failed) {
+
+        return;
+    }
+
+    m_buf      = buf;
+    m_numBytes = numBytes;
+    m_offset   = offset;
+    m_busy     = true;
+
+    m_cond.wakeAll();
+}
+
+/**
+ * @brief ChunkPipe::wait
+ * @return false if any chunk so far failed
+ */
+
+bool ChunkPipe::wait()
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (m_busy) {
+
+        m_cond.wait(&m_mutex);
+    }
+
+    return !m_failed;
+}
+
+/**
+ * @brief ChunkPipe::run
+ */
+
+void ChunkPipe::run()
+{
+    QMutexLocker locker(&m_mutex);
+
+    forever {
+
+        while (!m_busy && !m_stop) {
+
+            m_cond.wait(&m_mutex);
+        }
+
+        if (!m_busy) {
+
+            break;
+        }
+
+        MemoryBuffer$ buf = m_buf;
+
+        uint32_t numBytes = m_numBytes;
+
+        uint64_t offset = m_offset;
+
+        locker.unlock();
+
+        bool res = m_handler(buf, numBytes, offset);
+
+        locker.relock();
+
+        m_failed = m_failed || !res;
+
+        m_busy = false;
+
+        m_buf.reset();
+
+        m_cond.wakeAll();
+    }
+}
+
+// ============================================================ //
@@ -30,7 +30,10 @@
 #include "contactmodel.h"
 #include "backendbase.h"
 
-#include <QJsonObject>
+#include <QSet>
+#include <QMutex>
+
+#include <algorithm>
 
 #include <Zway/request.h>
 #include <Zway/request/requestevent.h>
@@ -39,6 +42,12 @@
 
 // ============================================================ //
 
+/**
+ * @brief Row changes above this are applied as a model reset
+ */
+
+static const qint32 MaxRowChanges = 64;
+
 /**
  * @brief ContactModel::ContactModel
  * @param backend
@@ -46,9 +55,35 @@
 
 ContactModel::ContactModel(BackendBase *backend) :
     QAbstractListModel(backend),
-    m_backend(backend)
+    m_backend(backend),
+    m_searchSeq(0),
+    m_local(false)
 {
-    QObject::connect(this, &ContactModel::updateView, this, &ContactModel::onUpdateView);
+    qRegisterMetaType<ContactModel::ContactRows>("ContactModel::ContactRows");
+
+    // keystrokes are coalesced, the filter runs once typing pauses
+
+    m_filterTimer.setSingleShot(true);
+
+    m_filterTimer.setInterval(150);
+
+    QObject::connect(&m_filterTimer, &QTimer::timeout, this, &ContactModel::onFilterTimeout);
+
+    QObject::connect(this, &ContactModel::searchResult, this, &ContactModel::onSearchResult);
+
+    QObject::connect(this, &ContactModel::updateContacts, this, &ContactModel::onUpdateContacts);
+
+    QObject::connect(backend, &BackendBase::contactStatusChanged, this, &ContactModel::onContactStatusChanged);
+
+    QObject::connect(backend, &BackendBase::contactStatusesChanged, this, &ContactModel::onContactStatusesChanged);
+
+    QObject::connect(backend, &BackendBase::inboxChanged, this, &ContactModel::onInboxChanged);
+
+    QObject::connect(backend, &BackendBase::contactRequest, this, &ContactModel::onContactRequest);
+
+    QObject::connect(backend, &BackendBase::contactRequestAccepted, this, &ContactModel::onContactRequest);
+
+    QObject::connect(backend, &BackendBase::contactRequestRejected, this, &ContactModel::onContactRequest);
 }
 
 /**
@@ -73,32 +108,39 @@ int ContactModel::rowCount(const QModelIndex &parent) const
 
 QVariant ContactModel::data(const QModelIndex &index, int role) const
 {
-    if (index.row() < 0 || index.row() > m_items.size()) {
+    if (index.row() < 0 || index.row() >= m_items.size()) {
 
         return QVariant();
     }
 
-    const QJsonObject item = m_items[index.row()].toObject();
+    const ContactRow &item = m_items[index.row()];
 
     switch (role) {
         case IdRole:
-            return item["id"];
+            return item.m_id ? QVariant(item.m_id) : QVariant();
         case TypeRole:
-            return item["type"];
+            return item.m_type >= 0 ? QVariant(item.m_type) : QVariant();
         case GroupRole:
-            return item["group"];
+            if (item.m_group == ContactGroup) {
+                return QStringLiteral("contact");
+            }
+            else
+            if (item.m_group == RequestGroup) {
+                return QStringLiteral("request");
+            }
+            break;
         case ColorRole:
-            return item["color"];
+            return item.m_color;
         case NameRole:
-            return item["name"];
+            return item.m_name;
         case PhoneRole:
-            return item["phone"];
+            return item.m_phone;
         case StatusRole:
-            return item["status"];
+            return item.m_status >= 0 ? QVariant(item.m_status) : QVariant();
         case InboxRole:
-            return item["inbox"];
+            return item.m_inbox >= 0 ? QVariant(item.m_inbox) : QVariant();
         case AddCodeRole:
-            return item["addCode"];
+            return item.m_addCode;
     }
 
     return QVariant();
@@ -114,12 +156,107 @@ QJsonValue ContactModel::get(int index)
 {
     if (index >= 0 && index < m_items.size()) {
 
-        return m_items[index].toObject();
+        return m_items[index].toJson();
     }
 
     return QJsonValue();
 }
 
+/**
+ * @brief ContactModel::setFilter
+ * @param filter
+ */
+
+void ContactModel::setFilter(const QString &filter)
+{
+    cancelSearch();
+
+    m_filter = filter;
+
+    m_local = true;
+
+    m_filterTimer.start();
+}
+
+/**
+ * @brief ContactModel::onFilterTimeout
+ */
+
+void ContactModel::onFilterTimeout()
+{
+    onUpdateView(filteredItems());
+}
+
+/**
+ * @brief ContactModel::intern
+ * @param str
+ * @return
+ */
+
+QString ContactModel::intern(const QString &str)
+{
+    static QHash<QString, QString> strings;
+
+    static QMutex mutex;
+
+    // rows share one copy of recurring values like colors
+
+    QMutexLocker locker(&mutex);
+
+    auto it = strings.find(str);
+
+    if (it == strings.end()) {
+
+        it = strings.insert(str, str);
+    }
+
+    return *it;
+}
+
+/**
+ * @brief ContactModel::fold
+ * @param str
+ * @return
+ */
+
+QString ContactModel::fold(const QString &str)
+{
+    // strip accents and case, so "Jose" matches "José"
+
+    QString res;
+
+    for (auto c : str.normalized(QString::NormalizationForm_D)) {
+
+        if (c.category() != QChar::Mark_NonSpacing) {
+
+            res += c;
+        }
+    }
+
+    return res.toCaseFolded();
+}
+
+/**
+ * @brief ContactModel::digits
+ * @param str
+ * @return
+ */
+
+QString ContactModel::digits(const QString &str)
+{
+    QString res;
+
+    for (auto c : str) {
+
+        if (c.isDigit()) {
+
+            res += c;
+        }
+    }
+
+    return res;
+}
+
 /**
  * @brief ContactModel::updateItems
  * @param filter
@@ -129,110 +266,227 @@ QJsonValue ContactModel::get(int index)
 
 void ContactModel::updateItems(const QString &filter, const QString &searchOnline, const QJSValue &callback)
 {
-    if (!searchOnline.isEmpty()) {
-
-        m_backend->findContact(
+    // only the local contact list follows backend events
 
-                UBJ_OBJ("subject" << searchOnline.toStdString()),
+    m_local = searchOnline.isEmpty();
 
-                [this, callback] (RequestEvent$ event, Request$) {
+    cancelSearch();
 
-                    QJsonArray items;
+    if (!searchOnline.isEmpty()) {
 
-                    for (auto &it : event->data()["result"].toArray()) {
+        auto it = m_searchCache.find(searchOnline);
 
-                        QJsonObject item = m_backend->ubjToJsonObj(it);
+        if (it != m_searchCache.end() && it->m_timer.elapsed() < 60000) {
 
-                        item["color"] = QString::fromStdString(m_backend->store()->randomColor());
+            onUpdateView(it->m_items);
 
-                        items.append(item);
-                    }
+            emit m_backend->invokeCallback(callback);
 
-                    emit updateView(items);
+            return;
+        }
 
-                    emit m_backend->invokeCallback(callback);
-                });
+        startSearch(searchOnline, callback);
     }
     else {
 
-        LambdaRunnable::start([=] {
-
-            QJsonArray items;
+        m_filter = filter;
 
-            m_backend->store()->query(
-                        "contact_requests", {},
-                        [&] (bool error, Zway::UBJ::Store::Cursor$ cursor) {
+        loadContacts(callback);
+    }
+}
 
-                if (!error) {
+/**
+ * @brief ContactModel::startSearch
+ * @param query
+ * @param callback
+ */
 
-                    cursor->forEach([&] (UBJ::Object &request) {
+void ContactModel::startSearch(const QString &query, const QJSValue &callback)
+{
+    quint32 seq = m_searchSeq;
 
-                        QJsonObject map;
+    bool res = m_backend->findContact(
 
-                        qint32 type = request["src"].toUInt() == m_backend->store()->accountId() ? 1 : 2;
+            UBJ_OBJ("subject" << query.toStdString()),
 
-                        qint32 result = request["result"].toInt();
+            [this, seq, query, callback] (RequestEvent$ event, Request$) {
 
-                        if (result == Request::AcceptContact) {
+                ContactRows items;
 
-                            type = 3;
-                        }
-                        else
-                        if (result == Request::RejectContact) {
+                for (auto &it : event->data()["result"].toArray()) {
 
-                            type = 4;
-                        }
+                    ContactRow item = ContactRow::fromJson(m_backend->ubjToJsonObj(it));
 
-                        map["id"]      = request["id"].toInt();
-                        map["type"]    = type;
-                        map["group"]   = "request";
-                        map["color"]   = request["color"].toStr().c_str();
-                        map["status"]  = 0;
-                        map["name"]    = request["name"].toStr().c_str();
-                        map["phone"]   = request["phone"].toStr().c_str();
-                        map["addCode"] = request["addCode"].toStr().c_str();
+                    item.m_color = intern(QString::fromStdString(m_backend->store()->randomColor()));
 
-                        items.append(map);
-                    });
+                    items.append(item);
                 }
+
+                emit searchResult(items, event->error().size() > 0, seq, query);
+
+                emit m_backend->invokeCallback(callback);
             });
 
-            m_backend->store()->query(
-                        "contacts", {}, UBJ_OBJ("name" << 1), {}, 0, 0,
-                        [&] (bool error, UBJ::Store::Cursor$ cursor) {
+    if (!res) {
 
-                if (!error) {
+        emit m_backend->invokeCallback(callback);
+    }
+}
 
-                    cursor->forEach([&] (UBJ::Object &contact) {
+/**
+ * @brief ContactModel::cancelSearch
+ */
 
-                        QString name = contact["name"].toStr().c_str();
+void ContactModel::cancelSearch()
+{
+    // responses of running searches and pending filter runs are stale from now on
 
-                        if (filter.isEmpty() || name.indexOf(filter, 0, Qt::CaseInsensitive) != -1) {
+    m_searchSeq++;
 
-                            QJsonObject map;
+    m_filterTimer.stop();
+}
 
-                            qint32 contactId = contact["id"].toInt();
+/**
+ * @brief ContactModel::onSearchResult
+ * @param items
+ * @param error
+ * @param seq
+ * @param query
+ */
 
-                            map["id"]     = contactId;
-                            map["type"]   = 0;
-                            map["group"]  = "contact";
-                            map["color"]  = contact["color"].toStr().c_str();
-                            map["name"]   = name;
-                            map["phone"]  = contact["phone"].toStr().c_str();
-                            map["status"] = (qint32)m_backend->contactStatus(contactId);
-                            map["inbox"]  = (qint32)m_backend->store()->numInboxMessages(contactId);
+void ContactModel::onSearchResult(const ContactRows &items, bool error, quint32 seq, const QString &query)
+{
+    if (!error) {
 
-                            items.append(map);
-                        }
-                    });
-                }
-            });
+        // keep the cache small, drop expired entries first
 
-            emit updateView(items);
+        if (m_searchCache.size() >= 32) {
 
-            emit m_backend->invokeCallback(callback);
-        });
+            for (auto it = m_searchCache.begin(); it != m_searchCache.end();) {
+
+                it = it->m_timer.elapsed() >= 60000 ? m_searchCache.erase(it) : it + 1;
+            }
+
+            if (m_searchCache.size() >= 32) {
+
+                m_searchCache.clear();
+            }
+        }
+
+        SearchResult &result = m_searchCache[query];
+
+        result.m_items = items;
+
+        result.m_timer.start();
     }
+
+    // a newer request superseded this one
+
+    if (seq != m_searchSeq || m_local) {
+
+        return;
+    }
+
+    onUpdateView(items);
+}
+
+/**
+ * @brief ContactModel::loadContacts
+ * @param callback
+ */
+
+void ContactModel::loadContacts(const QJSValue &callback)
+{
+    // always load the full list, filtering is done in memory
+
+    LambdaRunnable::start([=] {
+
+        ContactRows items;
+
+        m_backend->store()->query(
+                    "contact_requests", {},
+                    [&] (bool error, Zway::UBJ::Store::Cursor$ cursor) {
+
+            if (!error) {
+
+                cursor->forEach([&] (UBJ::Object &request) {
+
+                    ContactRow row;
+
+                    qint32 type = request["src"].toUInt() == m_backend->store()->accountId() ? 1 : 2;
+
+                    qint32 result = request["result"].toInt();
+
+                    if (result == Request::AcceptContact) {
+
+                        type = 3;
+                    }
+                    else
+                    if (result == Request::RejectContact) {
+
+                        type = 4;
+                    }
+
+                    row.m_id      = request["id"].toInt();
+                    row.m_type    = type;
+                    row.m_group   = RequestGroup;
+                    row.m_color   = intern(request["color"].toStr().c_str());
+                    row.m_status  = 0;
+                    row.m_name    = request["name"].toStr().c_str();
+                    row.m_phone   = request["phone"].toStr().c_str();
+                    row.m_addCode = request["addCode"].toStr().c_str();
+
+                    items.append(row);
+                });
+            }
+        });
+
+        ContactRows contacts;
+
+        QList<quint32> contactIds;
+
+        m_backend->store()->query(
+                    "contacts", {}, UBJ_OBJ("name" << 1), {}, 0, 0,
+                    [&] (bool error, UBJ::Store::Cursor$ cursor) {
+
+            if (!error) {
+
+                cursor->forEach([&] (UBJ::Object &contact) {
+
+                    ContactRow row;
+
+                    row.m_id    = contact["id"].toInt();
+                    row.m_type  = 0;
+                    row.m_group = ContactGroup;
+                    row.m_color = intern(contact["color"].toStr().c_str());
+                    row.m_name  = contact["name"].toStr().c_str();
+                    row.m_phone = contact["phone"].toStr().c_str();
+
+                    contacts.append(row);
+
+                    contactIds.append(row.m_id);
+                });
+            }
+        });
+
+        // fetch status and inbox counts in one go instead of per row
+
+        QHash<quint32, qint32> statuses = m_backend->contactStatuses(contactIds);
+
+        QHash<quint32, quint32> inboxCounts = m_backend->inboxCounts(contactIds);
+
+        for (auto &row : contacts) {
+
+            row.m_status = statuses[row.m_id];
+            row.m_inbox  = inboxCounts[row.m_id];
+
+            items.append(row);
+        }
+
+        emit updateContacts(items);
+
+        emit m_backend->invokeCallback(callback);
+    });
 }
 
 /**
@@ -243,23 +497,483 @@ void ContactModel::clearItems()
 {
     beginResetModel();
 
-    m_items = QJsonArray();
+    m_items.clear();
+
+    m_rows.clear();
+
+    m_local = false;
+
+    cancelSearch();
 
     endResetModel();
 }
 
+/**
+ * @brief ContactModel::onUpdateContacts
+ * @param items
+ */
+
+void ContactModel::onUpdateContacts(const ContactRows &items)
+{
+    m_allItems = items;
+
+    updateFilterIndex();
+
+    if (m_local) {
+
+        onUpdateView(filteredItems());
+    }
+}
+
 /**
  * @brief ContactModel::onUpdateView
  * @param items
  */
 
-void ContactModel::onUpdateView(const QJsonArray &items)
+void ContactModel::onUpdateView(const ContactRows &items)
 {
-    beginResetModel();
+    QSet<quint64> keys;
 
-    m_items = items;
+    for (auto &item : items) {
 
-    endResetModel();
+        keys.insert(item.key());
+    }
+
+    QSet<quint64> oldKeys;
+
+    for (auto &item : m_items) {
+
+        oldKeys.insert(item.key());
+    }
+
+    // search results have neither id nor group, the diff below needs unique keys on both sides
+
+    if (!m_local || keys.size() != items.size() || oldKeys.size() != m_items.size()) {
+
+        beginResetModel();
+
+        m_items = items;
+
+        endResetModel();
+
+        updateRows();
+
+        return;
+    }
+
+    // count the changes and check that the kept rows keep their order,
+    // moves can't be expressed with the insert and remove runs below
+
+    QSet<quint64> kept;
+
+    qint32 numRemoved = 0;
+
+    for (auto &item : m_items) {
+
+        if (keys.contains(item.key())) {
+
+            kept.insert(item.key());
+        }
+        else {
+
+            numRemoved++;
+        }
+    }
+
+    qint32 numInserted = items.size() - kept.size();
+
+    bool ordered = true;
+
+    for (qint32 i=0, j=0; i<items.size() && ordered; ++i) {
+
+        if (!kept.contains(items[i].key())) {
+
+            continue;
+        }
+
+        while (!keys.contains(m_items[j].key())) {
+
+            j++;
+        }
+
+        ordered = m_items[j++].key() == items[i].key();
+    }
+
+    // large changes, like the first load or clearing a filter, are one reset
+
+    if (!ordered || numRemoved + numInserted > MaxRowChanges) {
+
+        beginResetModel();
+
+        m_items = items;
+
+        endResetModel();
+
+        updateRows();
+
+        return;
+    }
+
+    // remove rows which are gone, one notification per contiguous run
+
+    for (qint32 i=m_items.size()-1; i>=0;) {
+
+        if (keys.contains(m_items[i].key())) {
+
+            i--;
+
+            continue;
+        }
+
+        qint32 last = i;
+
+        while (i >= 0 && !keys.contains(m_items[i].key())) {
+
+            i--;
+        }
+
+        beginRemoveRows(QModelIndex(), i + 1, last);
+
+        m_items.remove(i + 1, last - i);
+
+        endRemoveRows();
+    }
+
+    // walk the new list, updating kept rows and inserting runs of new ones
+
+    for (qint32 i=0; i<items.size();) {
+
+        if (kept.contains(items[i].key())) {
+
+            if (m_items[i] != items[i]) {
+
+                m_items[i] = items[i];
+
+                emit dataChanged(index(i), index(i));
+            }
+
+            i++;
+
+            continue;
+        }
+
+        qint32 first = i;
+
+        while (i < items.size() && !kept.contains(items[i].key())) {
+
+            i++;
+        }
+
+        beginInsertRows(QModelIndex(), first, i - 1);
+
+        m_items = m_items.mid(0, first) + items.mid(first, i - first) + m_items.mid(first);
+
+        endInsertRows();
+    }
+
+    updateRows();
+}
+
+/**
+ * @brief ContactModel::onContactStatusChanged
+ * @param contactId
+ * @param status
+ */
+
+void ContactModel::onContactStatusChanged(quint32 contactId, qint32 status)
+{
+    ContactRow key;
+
+    key.m_id    = contactId;
+    key.m_group = ContactGroup;
+
+    qint32 i = m_allRows.value(key.key(), -1);
+
+    if (i != -1) {
+
+        m_allItems[i].m_status = status;
+    }
+
+    if (!m_local) {
+
+        return;
+    }
+
+    qint32 row = contactRow(contactId);
+
+    if (row != -1 && m_items[row].m_status != status) {
+
+        m_items[row].m_status = status;
+
+        emit dataChanged(index(row), index(row), {StatusRole});
+    }
+}
+
+/**
+ * @brief ContactModel::onContactStatusesChanged
+ */
+
+void ContactModel::onContactStatusesChanged()
+{
+    QList<quint32> contactIds;
+
+    for (auto i : m_contactRows) {
+
+        contactIds.append(m_allItems[i].m_id);
+    }
+
+    QHash<quint32, qint32> statuses = m_backend->contactStatuses(contactIds);
+
+    for (auto i : m_contactRows) {
+
+        m_allItems[i].m_status = statuses[m_allItems[i].m_id];
+    }
+
+    // only rows whose status moved are reported as changed
+
+    if (m_local) {
+
+        onUpdateView(filteredItems());
+    }
+}
+
+/**
+ * @brief ContactModel::onInboxChanged
+ * @param contactId
+ * @param count
+ */
+
+void ContactModel::onInboxChanged(quint32 contactId, quint32 count)
+{
+    ContactRow key;
+
+    key.m_id    = contactId;
+    key.m_group = ContactGroup;
+
+    qint32 i = m_allRows.value(key.key(), -1);
+
+    if (i != -1) {
+
+        m_allItems[i].m_inbox = count;
+    }
+
+    if (!m_local) {
+
+        return;
+    }
+
+    qint32 row = contactRow(contactId);
+
+    if (row != -1) {
+
+        m_items[row].m_inbox = count;
+
+        emit dataChanged(index(row), index(row), {InboxRole});
+    }
+}
+
+/**
+ * @brief ContactModel::onContactRequest
+ */
+
+void ContactModel::onContactRequest()
+{
+    // requests move between groups, so reload and let onUpdateView apply the difference
+
+    loadContacts();
+}
+
+/**
+ * @brief ContactModel::updateFilterIndex
+ */
+
+void ContactModel::updateFilterIndex()
+{
+    m_allRows.clear();
+
+    m_contactRows.clear();
+
+    m_trigrams.clear();
+
+    m_lastFilter.clear();
+
+    m_lastMatches.clear();
+
+    m_foldedNames.fill(QString(), m_allItems.size());
+
+    m_phoneDigits.fill(QString(), m_allItems.size());
+
+    for (qint32 i=0; i<m_allItems.size(); ++i) {
+
+        const ContactRow &item = m_allItems[i];
+
+        m_allRows[item.key()] = i;
+
+        if (item.m_group != ContactGroup) {
+
+            continue;
+        }
+
+        m_contactRows.append(i);
+
+        QString name = fold(item.m_name);
+
+        m_foldedNames[i] = name;
+
+        m_phoneDigits[i] = digits(item.m_phone);
+
+        for (qint32 j=0; j+3<=name.size(); ++j) {
+
+            QVector<qint32> &list = m_trigrams[name.mid(j, 3)];
+
+            if (list.isEmpty() || list.last() != i) {
+
+                list.append(i);
+            }
+        }
+    }
+}
+
+/**
+ * @brief ContactModel::filterContacts
+ * @param filter
+ * @return
+ */
+
+QVector<qint32> ContactModel::filterContacts(const QString &filter)
+{
+    QString name = fold(filter.trimmed());
+
+    if (name.isEmpty()) {
+
+        return m_contactRows;
+    }
+
+    QString number = digits(name);
+
+    bool isNumber = !number.isEmpty();
+
+    for (auto c : name) {
+
+        if (c.isLetter()) {
+
+            isNumber = false;
+
+            break;
+        }
+    }
+
+    QVector<qint32> candidates;
+
+    if (!m_lastFilter.isEmpty() && name.startsWith(m_lastFilter)) {
+
+        // typing narrows the previous result
+
+        candidates = m_lastMatches;
+    }
+    else
+    if (!isNumber && name.size() >= 3) {
+
+        for (qint32 j=0; j+3<=name.size(); ++j) {
+
+            QVector<qint32> list = m_trigrams.value(name.mid(j, 3));
+
+            if (j == 0) {
+
+                candidates = list;
+            }
+            else {
+
+                QVector<qint32> tmp;
+
+                std::set_intersection(candidates.begin(), candidates.end(), list.begin(), list.end(), std::back_inserter(tmp));
+
+                candidates = tmp;
+            }
+
+            if (candidates.isEmpty()) {
+
+                break;
+            }
+        }
+    }
+    else {
+
+        candidates = m_contactRows;
+    }
+
+    QVector<qint32> res;
+
+    for (auto i : candidates) {
+
+        if (m_foldedNames[i].contains(name) || (isNumber && m_phoneDigits[i].contains(number))) {
+
+            res.append(i);
+        }
+    }
+
+    m_lastFilter = name;
+
+    m_lastMatches = res;
+
+    return res;
+}
+
+/**
+ * @brief ContactModel::filteredItems
+ * @return
+ */
+
+ContactModel::ContactRows ContactModel::filteredItems()
+{
+    ContactRows res;
+
+    // requests are always shown
+
+    for (auto &item : m_allItems) {
+
+        if (item.m_group != ContactGroup) {
+
+            res.append(item);
+        }
+    }
+
+    for (auto i : filterContacts(m_filter)) {
+
+        res.append(m_allItems[i]);
+    }
+
+    return res;
+}
+
+/**
+ * @brief ContactModel::contactRow
+ * @param contactId
+ * @return
+ */
+
+qint32 ContactModel::contactRow(quint32 contactId)
+{
+    ContactRow key;
+
+    key.m_id    = contactId;
+    key.m_group = ContactGroup;
+
+    return m_rows.value(key.key(), -1);
+}
+
+/**
+ * @brief ContactModel::updateRows
+ */
+
+void ContactModel::updateRows()
+{
+    m_rows.clear();
+
+    for (qint32 i=0; i<m_items.size(); ++i) {
+
+        m_rows[m_items[i].key()] = i;
+    }
 }
 
 /**
@@ -285,3 +999,96 @@ QHash<int, QByteArray> ContactModel::roleNames() const
 }
 
 // ============================================================ //
+
+/**
+ * @brief ContactModel::ContactRow::fromJson
+ * @param obj
+ * @return
+ */
+
+ContactModel::ContactRow ContactModel::ContactRow::fromJson(const QJsonObject &obj)
+{
+    ContactRow row;
+
+    QString group = obj["group"].toString();
+
+    row.m_id      = obj["id"].toVariant().toUInt();
+    row.m_group   = group == "contact" ? ContactGroup : (group == "request" ? RequestGroup : NoGroup);
+    row.m_type    = obj.contains("type") ? obj["type"].toInt() : -1;
+    row.m_status  = obj.contains("status") ? obj["status"].toInt() : -1;
+    row.m_inbox   = obj.contains("inbox") ? obj["inbox"].toInt() : -1;
+    row.m_color   = intern(obj["color"].toString());
+    row.m_name    = obj["name"].toString();
+    row.m_phone   = obj["phone"].toString();
+    row.m_addCode = obj["addCode"].toString();
+
+    return row;
+}
+
+/**
+ * @brief ContactModel::ContactRow::toJson
+ * @return
+ */
+
+QJsonObject ContactModel::ContactRow::toJson() const
+{
+    QJsonObject obj;
+
+    if (m_id) {
+
+        obj["id"] = (qint64)m_id;
+    }
+
+    if (m_group == ContactGroup) {
+
+        obj["group"] = "contact";
+    }
+    else
+    if (m_group == RequestGroup) {
+
+        obj["group"] = "request";
+    }
+
+    if (m_type >= 0) {
+
+        obj["type"] = m_type;
+    }
+
+    if (m_status >= 0) {
+
+        obj["status"] = m_status;
+    }
+
+    if (m_inbox >= 0) {
+
+        obj["inbox"] = m_inbox;
+    }
+
+    obj["color"]   = m_color;
+    obj["name"]    = m_name;
+    obj["phone"]   = m_phone;
+    obj["addCode"] = m_addCode;
+
+    return obj;
+}
+
+/**
+ * @brief ContactModel::ContactRow::operator ==
+ * @param other
+ * @return
+ */
+
+bool ContactModel::ContactRow::operator==(const ContactRow &other) const
+{
+    return m_id      == other.m_id &&
+           m_group   == other.m_group &&
+           m_type    == other.m_type &&
+           m_status  == other.m_status &&
+           m_inbox   == other.m_inbox &&
+           m_color   == other.m_color &&
+           m_name    == other.m_name &&
+           m_phone   == other.m_phone &&
+           m_addCode == other.m_addCode;
+}
+
+// ============================================================ //
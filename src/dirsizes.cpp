@@ -0,0 +1,237 @@
+
+// ============================================================ //
+//
+//   d88888D db   d8b   db  .d8b.  db    db
+//   YP  d8' 88   I8I   88 d8' `8b `8b  d8'
+//      d8'  88   I8I   88 88ooo88  `8bd8'
+//     d8'   Y8   I8I   88 88~~~88    88
+//    d8' db `8b d8'8b d8' 88   88    88
+//   d88888P  `8b8' `8d8'  YP   YP    YP
+//
+//   open-source, cross-platform, crypto-messenger
+//
+//   Copyright (C) 2018 Marc Weiler
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program. If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================ //
+
+#include "dirsizes.h"
+
+// ============================================================ //
+
+/**
+ * @brief DirSizes::DirSizes
+ */
+
+DirSizes::DirSizes()
+    : m_generation(0)
+{
+
+}
+
+/**
+ * @brief DirSizes::clear
+ */
+
+void DirSizes::clear()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_entries.clear();
+
+    m_generation++;
+}
+
+/**
+ * @brief DirSizes::get
+ * @param dirId
+ * @param entry
+ * @return
+ */
+
+bool DirSizes::get(uint64_t dirId, Entry &entry)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_entries.find(dirId);
+
+    if (it == m_entries.end()) {
+
+        return false;
+    }
+
+    entry = *it;
+
+    return true;
+}
+
+/**
+ * @brief DirSizes::aggregate
+ * @param store
+ * @param dirId
+ * @return
+ */
+
+DirSizes::Entry DirSizes::aggregate(Store$ store, uint64_t dirId)
+{
+    Entry entry;
+
+    if (get(dirId, entry) || !store) {
+
+        return entry;
+    }
+
+    quint32 generation;
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        generation = m_generation;
+    }
+
+    // cached subdirectories are reused, so only the missing part of the tree is walked
+
+    std::list<UBJ::Object> nodes;
+
+    store->query("vfs", UBJ_OBJ("parent" << dirId), nodes, {}, UBJ_ARR("rowid" << "type" << "size"));
+
+    for (auto &node : nodes) {
+
+        if (node["type"].toInt() == Store::Directory) {
+
+            Entry sub = aggregate(store, node["rowid"].toLong());
+
+            entry.m_size += sub.m_size;
+
+            entry.m_numItems += sub.m_numItems + 1;
+        }
+        else {
+
+            entry.m_size += node["size"].toLong();
+
+            entry.m_numItems++;
+        }
+    }
+
+    // a change made meanwhile may not be part of the result, so it isn't kept
+
+    QMutexLocker locker(&m_mutex);
+
+    if (generation == m_generation) {
+
+        m_entries[dirId] = entry;
+    }
+
+    return entry;
+}
+
+/**
+ * @brief DirSizes::adjust
+ * @param store
+ * @param dirId
+ * @param size
+ * @param numItems
+ */
+
+void DirSizes::adjust(Store$ store, uint64_t dirId, int64_t size, qint32 numItems)
+{
+    forever {
+
+        {
+            QMutexLocker locker(&m_mutex);
+
+            m_generation++;
+
+            auto it = m_entries.find(dirId);
+
+            if (it == m_entries.end()) {
+
+                break;
+            }
+
+            it->m_size = qMax<int64_t>(0, (int64_t)it->m_size + size);
+
+            it->m_numItems = qMax<qint64>(0, (qint64)it->m_numItems + numItems);
+        }
+
+        if (!dirId || !parentDir(store, dirId)) {
+
+            break;
+        }
+    }
+}
+
+/**
+ * @brief DirSizes::invalidate
+ * @param store
+ * @param dirId
+ */
+
+void DirSizes::invalidate(Store$ store, uint64_t dirId)
+{
+    forever {
+
+        {
+            QMutexLocker locker(&m_mutex);
+
+            m_generation++;
+
+            if (!m_entries.remove(dirId)) {
+
+                break;
+            }
+        }
+
+        if (!dirId || !parentDir(store, dirId)) {
+
+            break;
+        }
+    }
+}
+
+/**
+ * @brief DirSizes::remove
+ * @param dirId
+ */
+
+void DirSizes::remove(uint64_t dirId)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_entries.remove(dirId);
+}
+
+/**
+ * @brief DirSizes::parentDir
+ * @param store
+ * @param dirId
+ * @return
+ */
+
+bool DirSizes::parentDir(Store$ store, uint64_t &dirId)
+{
+    UBJ::Object node;
+
+    if (!store || !store->query("vfs", UBJ_OBJ("rowid" << dirId), &node, {}, {"parent"})) {
+
+        return false;
+    }
+
+    dirId = node["parent"].toLong();
+
+    return true;
+}
+
+// ============================================================ //
@@ -29,8 +29,25 @@
 
 #include "filesystemmodel.h"
 #include "backendbase.h"
+#include "chunkpipe.h"
 
 #include <QDir>
+#include <QDirIterator>
+#include <QDateTime>
+#include <QSemaphore>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QQueue>
+
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#endif
 
 #include <Zway/memorybuffer.h>
 #include <Zway/ubj/store/blob.h>
@@ -46,8 +63,36 @@
 FileSystemModel::FileSystemModel(BackendBase *backend) :
     QAbstractListModel(backend),
     m_backend(backend),
-    m_numItemsTotal(0)
+    m_numItemsTotal(0),
+    m_deleteRunning(false),
+    m_deleteCancelled(0),
+    m_exportChunkSize(4 * 1024 * 1024),
+    m_listSeq(0),
+    m_listing(false),
+    m_pendingItems(0),
+    m_copyCancelled(0),
+    m_copyChunkSize(4 * 1024 * 1024),
+    m_sortKey(SortByName),
+    m_sortAscending(true),
+    m_mediaFilter(0)
 {
+    qRegisterMetaType<FileSystemModel::FileRows>("FileRows");
+
+    qRegisterMetaType<FileSystemModel::FileRows>("FileSystemModel::FileRows");
+
+    QObject::connect(this, &FileSystemModel::insertEntries, this, &FileSystemModel::onInsertEntries);
+
+    QObject::connect(this, &FileSystemModel::refreshEntries, this, &FileSystemModel::onRefreshEntries);
+
+    QObject::connect(this, &FileSystemModel::mediaTypeDetected, this, &FileSystemModel::onMediaTypeDetected);
+
+    QObject::connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &FileSystemModel::onDirectoryChanged);
+
+    m_refreshTimer.setSingleShot(true);
+
+    m_refreshTimer.setInterval(200);
+
+    QObject::connect(&m_refreshTimer, &QTimer::timeout, this, &FileSystemModel::refresh);
 
 #ifdef Q_OS_ANDROID
 
@@ -88,24 +133,24 @@ QVariant FileSystemModel::data(const QModelIndex &index, int role) const
         return QVariant();
     }
 
-    const QFileInfo &item = m_items[index.row()];
+    const FileRow &item = m_items[index.row()];
 
     switch (role) {
         case IdRole:
-            return item.absoluteFilePath();
+            return item.m_path;
         case TypeRole:
-            if (item.isDir()) {
-                return 1;
-            }
-            else
-            if (item.isFile()) {
-                return 2;
+            if (item.m_type) {
+                return item.m_type;
             }
             break;
         case NameRole:
-            return item.fileName();
+            return item.m_name;
         case SizeRole:
-            return item.size();
+            return item.m_size;
+        case TimeRole:
+            return item.m_time;
+        case MediaTypeRole:
+            return item.m_mediaType;
         case OriginRole:
             return 1;
     }
@@ -128,22 +173,19 @@ QVariant FileSystemModel::getItemData(qint32 index) const
 
     QVariantMap res;
 
-    const QFileInfo &item = m_items[index];
+    const FileRow &item = m_items[index];
 
-    if (item.isDir()) {
-
-        res["type"] = 1;
-    }
-    else
-    if (item.isFile()) {
+    if (item.m_type) {
 
-        res["type"] = 2;
+        res["type"] = item.m_type;
     }
 
-    res["id"]     = item.absoluteFilePath();
-    res["path"]   = item.absoluteFilePath();
-    res["name"]   = item.fileName();
-    res["size"]   = item.size();
+    res["id"]     = item.m_path;
+    res["path"]   = item.m_path;
+    res["name"]   = item.m_name;
+    res["size"]   = item.m_size;
+    res["time"]   = item.m_time;
+    res["mediaType"] = item.m_mediaType;
     res["origin"] = 1;
 
     return res;
@@ -165,61 +207,74 @@ bool FileSystemModel::cd(const QString &dir)
 
         m_currentDir = d.absolutePath();
 
-        m_itemsFull = d.entryInfoList(QDir::NoFilter, QDir::DirsFirst);
+        // a watched snapshot is up to date, no need to list again, unless filtering needs media types it may lack
 
-        m_itemsFull.removeFirst();
+        auto snapshot = m_snapshots.find(m_currentDir);
 
-        m_itemsFull.removeFirst();
+        if (snapshot != m_snapshots.end() && !m_mediaFilter) {
 
-        m_numItemsTotal = m_itemsFull.size();
+            m_snapshotsLru.removeOne(m_currentDir);
 
-        return true;
-    }
+            m_snapshotsLru.append(m_currentDir);
 
-    return false;
-}
+            m_entries = *snapshot;
 
-/**
- * @brief FileSystemModel::moreItems
- * @param numItems
- * @param callback
- * @return
- */
+            sortEntries(m_entries, m_sortKey, m_sortAscending);
 
-bool FileSystemModel::moreItems(qint32 numItems, const QJSValue &callback)
-{
-    if (!m_itemsFull.empty()) {
+            m_itemsFull = filterEntries(m_entries, m_mediaFilter);
 
-        qint32 num = numItems;
+            m_numItemsTotal = m_itemsFull.size();
 
-        if (num > m_itemsFull.size()) {
+            emit numItemsTotalChanged();
 
-            num = m_itemsFull.size();
+            return true;
         }
 
-        beginInsertRows(QModelIndex(), m_items.size(), m_items.size() + num - 1);
+        m_listing = true;
 
-        QFileInfoList::iterator a = m_itemsFull.begin();
-        QFileInfoList::iterator b = m_itemsFull.begin() + num;
+        // entries are streamed in batches, a newer cd or clear stops the walk
 
-        std::move(a, b, std::back_inserter(m_items));
+        quint32 seq = m_listSeq.load();
 
-        m_itemsFull.erase(a, b);
+        QString path = m_currentDir;
 
-        endInsertRows();
+        // media types are detected while listing only when filtering needs them, otherwise once a row is shown
 
-        // invoke callback if any
+        MediaTypes *mediaTypes = m_mediaFilter ? &m_backend->mediaTypes() : nullptr;
 
-        QJSValue cb(callback);
+        LambdaRunnable::start([this, seq, path, mediaTypes] {
 
-        if (cb.isCallable()) {
+            QDirIterator it(path, QDir::AllEntries | QDir::NoDotAndDotDot);
 
-            QJSValueList args;
+            FileRows entries;
 
-            args.append(num);
+            qint32 batchSize = 64;
 
-            cb.call(args);
-        }
+            while (it.hasNext()) {
+
+                if ((quint32)m_listSeq.load() != seq) {
+
+                    return;
+                }
+
+                it.next();
+
+                // all metadata is read here, the GUI thread never stats
+
+                entries.append(FileRow::fromInfo(it.fileInfo(), mediaTypes));
+
+                if (entries.size() >= batchSize) {
+
+                    emit insertEntries(seq, entries, false);
+
+                    entries.clear();
+
+                    batchSize = 1024;
+                }
+            }
+
+            emit insertEntries(seq, entries, true);
+        });
 
         return true;
     }
@@ -228,433 +283,1432 @@ bool FileSystemModel::moreItems(qint32 numItems, const QJSValue &callback)
 }
 
 /**
- * @brief FileSystemModel::currentDir
- * @return
+ * @brief FileSystemModel::onInsertEntries
+ * @param seq
+ * @param entries
+ * @param finished
  */
 
-QString FileSystemModel::currentDir()
+void FileSystemModel::onInsertEntries(quint32 seq, const FileRows &entries, bool finished)
 {
-    return m_currentDir;
-}
+    if (seq != (quint32)m_listSeq.load()) {
 
-/**
- * @brief FileSystemModel::numItemsTotal
- * @return
- */
+        return;
+    }
 
-quint32 FileSystemModel::numItemsTotal()
-{
-    return m_numItemsTotal;
-}
+    // the full listing is kept for the snapshot, only matching rows are shown
 
-/**
- * @brief FileSystemModel::clear
- */
+    m_entries.append(entries);
 
-void FileSystemModel::clear()
-{
-    beginResetModel();
+    FileRows rows = filterEntries(entries, m_mediaFilter);
 
-    m_itemsFull.clear();
+    m_itemsFull.append(rows);
 
-    m_items.clear();
+    m_numItemsTotal += rows.size();
 
-    m_currentDir.clear();
+    if (finished) {
 
-    m_numItemsTotal = 0;
+        m_listing = false;
 
-    endResetModel();
+        sortEntries();
+
+        sortEntries(m_entries, m_sortKey, m_sortAscending);
+
+        storeSnapshot(m_currentDir, m_entries);
+    }
+
+    emit numItemsTotalChanged();
+
+    // waiting callers are answered with the next rows, or with 0 when the listing ended without any
+
+    if ((m_pendingItems > 0 || !m_pendingCallbacks.empty()) && (!m_itemsFull.empty() || finished)) {
+
+        qint32 numItems = m_pendingItems;
+
+        m_pendingItems = 0;
+
+        moreItems(numItems);
+    }
 }
 
 /**
- * @brief FileSystemModel::createDirectory
- * @param name
- * @param parent
- * @param callback
+ * @brief FileSystemModel::sortEntries
  */
 
-void FileSystemModel::createDirectory(const QString &name, const QString &parent, const QJSValue &callback)
+void FileSystemModel::sortEntries()
 {
-    LambdaRunnable::start([this, name, parent, callback] {
+    FileRows entries = m_items + m_itemsFull;
 
-        QDir d(m_currentDir);
+    sortEntries(entries, m_sortKey, m_sortAscending);
 
-        if (!d.mkdir(name)) {
+    emit layoutAboutToBeChanged();
 
-        }
+    m_items = entries.mid(0, m_items.size());
 
-        emit m_backend->invokeCallback(callback);
+    m_itemsFull = entries.mid(m_items.size());
 
-    });
+    emit layoutChanged();
 }
 
 /**
- * @brief FileSystemModel::deleteItems
- * @param items
- * @param callback
+ * @brief FileSystemModel::sortEntries
+ * @param entries
+ * @param key
+ * @param ascending
  */
 
-void FileSystemModel::deleteItems(const QVariantList &items, const QJSValue &callback)
+void FileSystemModel::sortEntries(FileRows &entries, qint32 key, bool ascending)
 {
-    LambdaRunnable::start([this, items, callback] {
+    // only precomputed fields are compared, directories come first, then files, then anything else
 
-        for (QVariant it : items) {
+    auto rank = [] (const FileRow &row) {
 
-            QFileInfo info(it.toString());
+        return row.m_type == 1 ? 0 : row.m_type == 2 ? 1 : 2;
+    };
 
-            if (info.isDir()) {
+    std::stable_sort(entries.begin(), entries.end(), [key, ascending, rank] (const FileRow &a, const FileRow &b) {
 
-                QDir d(it.toString());
+        if (rank(a) != rank(b)) {
 
-                if (!d.removeRecursively()) {
+            return rank(a) < rank(b);
+        }
 
-                }
-            }
-            else
-            if (info.isFile()) {
+        const FileRow &x = ascending ? a : b;
+        const FileRow &y = ascending ? b : a;
 
-                if (!QFile::remove(info.absoluteFilePath())) {
+        if (key == SortBySize && x.m_size != y.m_size) {
 
-                }
-            }
+            return x.m_size < y.m_size;
         }
+        else
+        if (key == SortByTime && x.m_time != y.m_time) {
 
-        emit m_backend->invokeCallback(callback);
+            return x.m_time < y.m_time;
+        }
+
+        return x.m_sortName < y.m_sortName;
     });
 }
 
 /**
- * @brief FileSystemModel::pasteFromFileSystem
- * @param items
- * @param dst
- * @param callback
+ * @brief FileSystemModel::sort
+ * @param key
+ * @param ascending
  */
 
-void FileSystemModel::pasteFromFileSystem(const QVariantList &items, const QString &dst, const QJSValue &callback)
+void FileSystemModel::sort(qint32 key, bool ascending)
 {
-    LambdaRunnable::start([this, items, dst, callback] {
-
-        QFileInfo info(dst);
+    m_sortKey = key;
 
-        if (!info.isDir()) {
+    m_sortAscending = ascending;
 
-            // TODO we need to pass an error here
+    if (!m_listing) {
 
-            emit m_backend->invokeCallback(callback);
+        sortEntries();
+    }
+}
 
-            return;
-        }
+/**
+ * @brief FileSystemModel::setMediaFilter
+ * @param mediaType
+ */
 
-        // process items to paste
+void FileSystemModel::setMediaFilter(qint32 mediaType)
+{
+    m_mediaFilter = mediaType;
+}
 
-        for (QVariant it : items) {
+/**
+ * @brief FileSystemModel::detectMediaType
+ * @param index
+ * @param callback
+ */
 
-            QFileInfo info(it.toString());
+void FileSystemModel::detectMediaType(qint32 index, const QJSValue &callback)
+{
+    if (index < 0 || index >= m_items.size() ||
+        m_items[index].m_type != 2 || m_items[index].m_mediaType != MediaTypes::Unknown) {
 
-            if (info.isFile()) {
+        QJSValue cb(callback);
 
-                if (!copyFile(info.absoluteFilePath(), dst)) {
+        if (cb.isCallable()) {
 
-                    // TODO pass error to callback
+            cb.call({index >= 0 && index < m_items.size() ? m_items[index].m_mediaType : MediaTypes::Unknown});
+        }
 
-                    emit m_backend->invokeCallback(callback);
+        return;
+    }
 
-                    return;
-                }
-            }
-            else
-            if (info.isDir()) {
+    // the header is read once the row is shown, the cache makes later listings cheap
 
-                if (!copyDirectory(info.absoluteFilePath(), dst, true)) {
+    quint32 seq = m_listSeq.load();
 
-                    // TODO pass error to callback
+    FileRow row = m_items[index];
 
-                    emit m_backend->invokeCallback(callback);
+    LambdaRunnable::start([this, seq, index, row, callback] {
 
-                    return;
-                }
-            }
-        }
+        qint32 mediaType = m_backend->mediaTypes().fromFile(row.m_path, row.m_size, row.m_time);
 
-        emit m_backend->invokeCallback(callback);
+        emit mediaTypeDetected(seq, index, row.m_path, mediaType, callback);
     });
 }
 
 /**
- * @brief FileSystemModel::pasteFromLocalStore
- * @param items
- * @param dst
+ * @brief FileSystemModel::onMediaTypeDetected
+ * @param seq
+ * @param index
+ * @param path
+ * @param mediaType
  * @param callback
  */
 
-void FileSystemModel::pasteFromLocalStore(const QVariantList &items, const QString &dst, const QJSValue &callback)
+void FileSystemModel::onMediaTypeDetected(quint32 seq, qint32 index, const QString &path, qint32 mediaType, const QJSValue &callback)
 {
-    LambdaRunnable::start([this, items, dst, callback] {
+    if (seq == (quint32)m_listSeq.load()) {
 
-        QFileInfo info(dst);
+        // a refresh may have moved the row meanwhile
 
-        if (!info.isDir()) {
+        if (index >= m_items.size() || m_items[index].m_path != path) {
 
-            //emit m_client->invokeCallback(callback);
+            index = -1;
 
-            return;
+            for (qint32 i = 0; i < m_items.size(); ++i) {
+
+                if (m_items[i].m_path == path) {
+
+                    index = i;
+
+                    break;
+                }
+            }
         }
 
-        for (QVariant it : items) {
+        if (index >= 0) {
 
-            UBJ::Object node;
+            m_items[index].m_mediaType = mediaType;
 
-            if (m_backend->store()->query("vfs", UBJ_OBJ("rowid" << (uint64_t)it.toULongLong()), &node, {}, {"type"})) {
+            emit dataChanged(this->index(index), this->index(index), {MediaTypeRole});
+        }
+    }
 
-                if (node["type"].toInt() == Store::File) {
+    QJSValue cb(callback);
 
-                    if (!copyResource(it.toULongLong(), dst)) {
+    if (cb.isCallable()) {
 
-                        // TODO pass error to callback
+        cb.call({mediaType});
+    }
+}
 
-                        //emit m_client->invokeCallback(callback);
+/**
+ * @brief FileSystemModel::filterEntries
+ * @param entries
+ * @param mediaType
+ * @return
+ */
 
-                        //return;
-                    }
-                }
-                else
-                if (node["type"].toInt() == Store::Directory) {
+FileSystemModel::FileRows FileSystemModel::filterEntries(const FileRows &entries, qint32 mediaType)
+{
+    if (!mediaType) {
 
-                    if (!copyDirectory(it.toULongLong(), dst)) {
+        return entries;
+    }
 
-                        // TODO pass error to callback
+    // directories are kept so the filtered view can still be navigated
 
-                        //emit m_client->invokeCallback(callback);
+    FileRows res;
 
-                        //return;
-                    }
-                }
-            }
+    for (auto &entry : entries) {
+
+        if (entry.m_type == 1 || entry.m_mediaType == mediaType) {
+
+            res.append(entry);
         }
+    }
 
-        emit m_backend->invokeCallback(callback);
-    });
+    return res;
 }
 
 /**
- * @brief FileSystemModel::copyFile
- * @param src
- * @param dst
- * @return
+ * @brief FileSystemModel::storeSnapshot
+ * @param path
+ * @param entries
  */
 
-bool FileSystemModel::copyFile(const QString &src, const QString &dst)
+void FileSystemModel::storeSnapshot(const QString &path, const FileRows &entries)
 {
-    QDir dstDir(dst);
+    // only directories the watcher accepted can be trusted later
+
+    if (!m_snapshots.contains(path) && !m_watcher.addPath(path)) {
 
-    QFileInfo srcInfo(src);
+        return;
+    }
 
-    // check whether file with same name already exists
+    m_snapshots[path] = entries;
 
-    QFileInfo dstInfo(dstDir.filePath(srcInfo.fileName()));
+    m_snapshotsLru.removeOne(path);
 
-    if (dstInfo.isFile()) {
+    m_snapshotsLru.append(path);
 
-        return true;
+    while (m_snapshotsLru.size() > 16) {
+
+        dropSnapshot(m_snapshotsLru.first());
     }
+}
 
-    // copy file
+/**
+ * @brief FileSystemModel::dropSnapshot
+ * @param path
+ */
 
-    if (!QFile::copy(src, dstInfo.absoluteFilePath())) {
+void FileSystemModel::dropSnapshot(const QString &path)
+{
+    m_snapshots.remove(path);
 
-        return false;
-    }
+    m_snapshotsLru.removeOne(path);
 
-    return true;
+    m_watcher.removePath(path);
 }
 
 /**
- * @brief FileSystemModel::copyDirectory
- * @param src
- * @param dst
- * @param recursive
- * @return
+ * @brief FileSystemModel::onDirectoryChanged
+ * @param path
  */
 
-bool FileSystemModel::copyDirectory(const QString &src, const QString &dst, bool recursive)
+void FileSystemModel::onDirectoryChanged(const QString &path)
 {
-    if (src == dst) {
+    if (path != m_currentDir) {
 
-        return false;
+        dropSnapshot(path);
+
+        return;
     }
 
-    QDir srcDir(src);
+    // changes come in bursts, refresh once they settle
 
-    QString name = srcDir.dirName();
+    m_refreshTimer.start();
+}
 
-    QDir dstDir(dst);
+/**
+ * @brief FileSystemModel::refresh
+ */
 
-    if (dstDir.cd(name)) {
+void FileSystemModel::refresh()
+{
+    if (m_listing || m_currentDir.isEmpty()) {
 
-        return false;
+        return;
     }
 
-    if (!(dstDir.mkdir(name) && dstDir.cd(name))) {
+    quint32 seq = m_listSeq.load();
 
-        return false;
-    }
+    QString path = m_currentDir;
 
-    QFileInfoList files = srcDir.entryInfoList(QDir::NoFilter, QDir::DirsFirst);
+    qint32 sortKey = m_sortKey;
 
-    for (auto &file : files) {
+    bool sortAscending = m_sortAscending;
 
-        if (file.fileName() == "." || file.fileName() == "..") {
+    MediaTypes *mediaTypes = m_mediaFilter ? &m_backend->mediaTypes() : nullptr;
 
-            continue;
-        }
+    LambdaRunnable::start([this, seq, path, sortKey, sortAscending, mediaTypes] {
 
-        if (file.isFile()) {
+        QDirIterator it(path, QDir::AllEntries | QDir::NoDotAndDotDot);
 
-            if (!copyFile(file.absoluteFilePath(), dstDir.absolutePath())) {
+        FileRows entries;
 
-                return false;
-            }
-        }
-        else
-        if (file.isDir()) {
+        while (it.hasNext()) {
 
-            if (!copyDirectory(file.absoluteFilePath(), dstDir.absolutePath(), recursive)) {
+            if ((quint32)m_listSeq.load() != seq) {
 
-                return false;
+                return;
             }
+
+            it.next();
+
+            entries.append(FileRow::fromInfo(it.fileInfo(), mediaTypes));
         }
-    }
 
-    return true;
+        sortEntries(entries, sortKey, sortAscending);
+
+        emit refreshEntries(seq, entries);
+    });
 }
 
 /**
- * @brief FileSystemModel::copyResource
- * @param src
- * @param dst
- * @return
+ * @brief FileSystemModel::onRefreshEntries
+ * @param seq
+ * @param listing
  */
 
-bool FileSystemModel::copyResource(uint64_t src, const QString &dst)
+void FileSystemModel::onRefreshEntries(quint32 seq, const FileRows &listing)
 {
-    UBJ::Object node;
-
-    if (!m_backend->store()->query("vfs", UBJ_OBJ("rowid" << src << "type" << Store::File), &node, {}, {"name", "data"})) {
+    if (seq != (quint32)m_listSeq.load() || m_listing) {
 
-        return false;
+        return;
     }
 
-    QFileInfo info(QDir(dst).filePath(node["name"].toStr().c_str()));
-
-    if (info.isFile()) {
+    m_entries = listing;
 
-        return true;
-    }
+    FileRows entries = filterEntries(listing, m_mediaFilter);
 
-    QFile file(info.absoluteFilePath());
+    QHash<QString, qint32> names;
 
-    if (!file.open(QFile::WriteOnly)) {
+    for (qint32 i = 0; i < entries.size(); ++i) {
 
-        return false;
+        names.insert(entries[i].m_name, i);
     }
 
-    m_backend->store()->readBlob("blob3", node["data"].toLong(), [&info, &file] (bool error, UBJ::Store::Blob$ blob) {
+    // the diff below needs the kept rows in the same order, anything moved resets the model
 
-        if (!error) {
+    qint32 last = -1;
 
-            uint32_t blockSize = 4096;
+    bool ordered = true;
 
-            uint32_t bytesWritten = 0;
+    for (const FileRows *rows : {&m_items, &m_itemsFull}) {
 
-            MemoryBuffer$ buf = MemoryBuffer::create(nullptr, blockSize);
+        for (auto &row : *rows) {
 
-            if (!buf) {
+            if (!ordered) {
 
-                return;
+                break;
             }
 
-            while (bytesWritten < blob->size()) {
+            auto it = names.constFind(row.m_name);
 
-                uint32_t bytesToWrite = blockSize;
+            if (it != names.constEnd()) {
 
-                if (blob->size() - bytesWritten < blockSize) {
+                if (it.value() < last) {
 
-                    bytesToWrite = blob->size() - bytesWritten;
+                    ordered = false;
                 }
 
-                blob->read(buf, bytesToWrite, bytesWritten);
-
-                file.write((char*)buf->data(), bytesToWrite);
-
-                bytesWritten += bytesToWrite;
-
-                buf->clear();
+                last = it.value();
             }
         }
-    });
+    }
 
-    file.close();
+    if (!ordered) {
 
-    return true;
-}
+        qint32 numVisible = m_itemsFull.empty() ? entries.size() : qMin(m_items.size(), entries.size());
 
-/**
- * @brief FileSystemModel::copyDirectory
- * @param src
- * @param dst
- * @param recursive
- * @return
- */
+        beginResetModel();
 
-bool FileSystemModel::copyDirectory(uint64_t src, const QString &dst, bool recursive)
-{
-    UBJ::Object node;
+        m_items = entries.mid(0, numVisible);
 
-    if (!m_backend->store()->query("vfs", UBJ_OBJ("rowid" << src), &node, {}, {"name"})) {
+        m_itemsFull = entries.mid(numVisible);
 
-        return false;
-    }
+        endResetModel();
 
-    QString name = node["name"].toStr().c_str();
+        m_numItemsTotal = entries.size();
 
-    QDir dir(dst);
+        emit numItemsTotalChanged();
 
-    if (dir.cd(name)) {
+        if (m_snapshots.contains(m_currentDir)) {
 
-        return false;
+            m_snapshots[m_currentDir] = listing;
+        }
+
+        return;
     }
 
-    if (!(dir.mkdir(name) && dir.cd(name))) {
+    // remove rows which are gone, visible ones with a notification
 
-        return false;
+    for (qint32 i = m_itemsFull.size() - 1; i >= 0; --i) {
+
+        if (!names.contains(m_itemsFull[i].m_name)) {
+
+            m_itemsFull.removeAt(i);
+        }
+    }
+
+    for (qint32 i = m_items.size() - 1; i >= 0; --i) {
+
+        if (!names.contains(m_items[i].m_name)) {
+
+            beginRemoveRows(QModelIndex(), i, i);
+
+            m_items.removeAt(i);
+
+            endRemoveRows();
+        }
+    }
+
+    // walk the new listing, both lists keep its order, so new entries go to their sorted position
+
+    bool allVisible = m_itemsFull.empty();
+
+    for (qint32 i = 0; i < entries.size(); ++i) {
+
+        const FileRow &entry = entries[i];
+
+        if (i < m_items.size()) {
+
+            if (m_items[i].m_name == entry.m_name) {
+
+                // keep a media type detected for the shown row while the file is unchanged
+
+                qint32 mediaType = m_items[i].m_mediaType;
+
+                bool unchanged = m_items[i].m_size == entry.m_size && m_items[i].m_time == entry.m_time;
+
+                m_items[i] = entry;
+
+                if (unchanged && entry.m_mediaType == MediaTypes::Unknown) {
+
+                    m_items[i].m_mediaType = mediaType;
+                }
+
+                continue;
+            }
+
+            beginInsertRows(QModelIndex(), i, i);
+
+            m_items.insert(i, entry);
+
+            endInsertRows();
+        }
+        else
+        if (allVisible) {
+
+            beginInsertRows(QModelIndex(), i, i);
+
+            m_items.append(entry);
+
+            endInsertRows();
+        }
+        else {
+
+            qint32 j = i - m_items.size();
+
+            if (j < m_itemsFull.size() && m_itemsFull[j].m_name == entry.m_name) {
+
+                m_itemsFull[j] = entry;
+            }
+            else {
+
+                m_itemsFull.insert(j, entry);
+            }
+        }
+    }
+
+    // sizes and dates may have changed for the kept rows too
+
+    if (!m_items.empty()) {
+
+        emit dataChanged(index(0), index(m_items.size() - 1));
+    }
+
+    m_numItemsTotal = entries.size();
+
+    emit numItemsTotalChanged();
+
+    if (m_snapshots.contains(m_currentDir)) {
+
+        m_snapshots[m_currentDir] = listing;
+    }
+}
+
+/**
+ * @brief FileSystemModel::moreItems
+ * @param numItems
+ * @param callback
+ * @return
+ */
+
+bool FileSystemModel::moreItems(qint32 numItems, const QJSValue &callback)
+{
+    // every caller is answered, merged requests included
+
+    if (callback.isCallable()) {
+
+        m_pendingCallbacks.append(callback);
+    }
+
+    if (m_itemsFull.empty() && m_listing) {
+
+        // served as soon as the next batch arrives
+
+        m_pendingItems += numItems;
+
+        return true;
+    }
+
+    qint32 num = qMin<qint32>(numItems, m_itemsFull.size());
+
+    if (num > 0) {
+
+        beginInsertRows(QModelIndex(), m_items.size(), m_items.size() + num - 1);
+
+        FileRows::iterator a = m_itemsFull.begin();
+        FileRows::iterator b = m_itemsFull.begin() + num;
+
+        std::move(a, b, std::back_inserter(m_items));
+
+        m_itemsFull.erase(a, b);
+
+        endInsertRows();
+    }
+
+    invokeCallbacks(m_pendingCallbacks, qMax(num, 0));
+
+    return num > 0;
+}
+
+/**
+ * @brief FileSystemModel::currentDir
+ * @return
+ */
+
+QString FileSystemModel::currentDir()
+{
+    return m_currentDir;
+}
+
+/**
+ * @brief FileSystemModel::numItemsTotal
+ * @return
+ */
+
+quint32 FileSystemModel::numItemsTotal()
+{
+    return m_numItemsTotal;
+}
+
+/**
+ * @brief FileSystemModel::clear
+ */
+
+void FileSystemModel::clear()
+{
+    beginResetModel();
+
+    m_listSeq.ref();
+
+    m_listing = false;
+
+    m_refreshTimer.stop();
+
+    m_pendingItems = 0;
+
+    QList<QJSValue> callbacks;
+
+    callbacks.swap(m_pendingCallbacks);
+
+    m_entries.clear();
+
+    m_itemsFull.clear();
+
+    m_items.clear();
+
+    m_currentDir.clear();
+
+    m_numItemsTotal = 0;
+
+    endResetModel();
+
+    // callers waiting for rows of the old listing are released
+
+    invokeCallbacks(callbacks, 0);
+}
+
+/**
+ * @brief FileSystemModel::invokeCallbacks
+ * @param callbacks
+ * @param numItems
+ */
+
+void FileSystemModel::invokeCallbacks(QList<QJSValue> &callbacks, qint32 numItems)
+{
+    QList<QJSValue> cbs;
+
+    cbs.swap(callbacks);
+
+    for (auto &callback : cbs) {
+
+        QJSValue cb(callback);
+
+        QJSValueList args;
+
+        args.append(numItems);
+
+        cb.call(args);
+    }
+}
+
+/**
+ * @brief FileSystemModel::createDirectory
+ * @param name
+ * @param parent
+ * @param callback
+ */
+
+void FileSystemModel::createDirectory(const QString &name, const QString &parent, const QJSValue &callback)
+{
+    LambdaRunnable::start([this, name, parent, callback] {
+
+        QDir d(m_currentDir);
+
+        if (!d.mkdir(name)) {
+
+        }
+
+        emit m_backend->invokeCallback(callback);
+
+    });
+}
+
+/**
+ * @brief FileSystemModel::deleteItems
+ * @param items
+ * @param callback
+ */
+
+void FileSystemModel::deleteItems(const QVariantList &items, const QJSValue &callback)
+{
+    LambdaRunnable::start([this, items, callback] {
+
+        QList<QPair<QString, QString>> entries;
+
+        for (QVariant it : items) {
+
+            QFileInfo info(it.toString());
+
+            if (!info.exists()) {
+
+                continue;
+            }
+
+            // a hidden sibling on the same file system, renaming is instant and hides the item
+
+            QString trash = info.absolutePath() + "/." + info.fileName() + QString(".deleted-%0").arg(QDateTime::currentMSecsSinceEpoch());
+
+            if (QFile::rename(info.absoluteFilePath(), trash)) {
+
+                entries.append({trash, info.absoluteFilePath()});
+            }
+            else {
+
+                entries.append({info.absoluteFilePath(), info.absoluteFilePath()});
+            }
+        }
+
+        emit m_backend->invokeCallback(callback);
+
+        bool start;
+
+        {
+            QMutexLocker locker(&m_deleteMutex);
+
+            m_deleteEntries.append(entries);
+
+            start = !m_deleteRunning;
+
+            m_deleteRunning = true;
+
+            m_deleteCancelled = 0;
+        }
+
+        if (start) {
+
+            removeEntries();
+        }
+    });
+}
+
+/**
+ * @brief FileSystemModel::cancelDelete
+ */
+
+void FileSystemModel::cancelDelete()
+{
+    m_deleteCancelled = 1;
+}
+
+/**
+ * @brief FileSystemModel::removeEntries
+ */
+
+void FileSystemModel::removeEntries()
+{
+    quint32 numDeleted = 0;
+
+    forever {
+
+        QPair<QString, QString> entry;
+
+        {
+            QMutexLocker locker(&m_deleteMutex);
+
+            if (m_deleteEntries.empty()) {
+
+                m_deleteRunning = false;
+
+                break;
+            }
+
+            entry = m_deleteEntries.takeFirst();
+        }
+
+        QFileInfo info(entry.first);
+
+        if (info.isDir() && !info.isSymLink()) {
+
+            // files go first, directories are removed deepest first once they are empty
+
+            QStringList dirs;
+
+            QDirIterator it(entry.first, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+
+            while (it.hasNext() && !m_deleteCancelled.load()) {
+
+                it.next();
+
+                QFileInfo file = it.fileInfo();
+
+                if (file.isDir() && !file.isSymLink()) {
+
+                    dirs.append(file.absoluteFilePath());
+                }
+                else
+                if (QFile::remove(file.absoluteFilePath())) {
+
+                    if (++numDeleted % 256 == 0) {
+
+                        emit deleteProgress(numDeleted, false);
+                    }
+                }
+            }
+
+            for (auto d = dirs.rbegin(); d != dirs.rend() && !m_deleteCancelled.load(); ++d) {
+
+                QDir().rmdir(*d);
+            }
+
+            QDir().rmdir(entry.first);
+        }
+        else {
+
+            QFile::remove(entry.first);
+        }
+
+        numDeleted++;
+
+        if (m_deleteCancelled.load()) {
+
+            // give back what is left, under its original name
+
+            QMutexLocker locker(&m_deleteMutex);
+
+            m_deleteEntries.prepend(entry);
+
+            for (auto &it : m_deleteEntries) {
+
+                if (it.first != it.second && QFileInfo::exists(it.first)) {
+
+                    QFile::rename(it.first, it.second);
+                }
+            }
+
+            m_deleteEntries.clear();
+
+            m_deleteRunning = false;
+
+            break;
+        }
+
+        emit deleteProgress(numDeleted, false);
+    }
+
+    emit deleteProgress(numDeleted, true);
+}
+
+/**
+ * @brief FileSystemModel::pasteFromFileSystem
+ * @param items
+ * @param dst
+ * @param callback
+ */
+
+void FileSystemModel::pasteFromFileSystem(const QVariantList &items, const QString &dst, const QJSValue &callback)
+{
+    LambdaRunnable::start([this, items, dst, callback] {
+
+        QFileInfo info(dst);
+
+        if (!info.isDir()) {
+
+            // TODO we need to pass an error here
+
+            emit m_backend->invokeCallback(callback);
+
+            return;
+        }
+
+        // process items to paste
+
+        QStringList paths;
+
+        for (QVariant it : items) {
+
+            paths.append(it.toString());
+        }
+
+        if (!copyTree(paths, info.absoluteFilePath())) {
+
+            // TODO pass error to callback
+        }
+
+        emit m_backend->invokeCallback(callback);
+    });
+}
+
+/**
+ * @brief FileSystemModel::cancelCopy
+ */
+
+void FileSystemModel::cancelCopy()
+{
+    m_copyCancelled = 1;
+}
+
+/**
+ * @brief FileSystemModel::pasteFromLocalStore
+ * @param items
+ * @param dst
+ * @param callback
+ */
+
+void FileSystemModel::pasteFromLocalStore(const QVariantList &items, const QString &dst, const QJSValue &callback)
+{
+    LambdaRunnable::start([this, items, dst, callback] {
+
+        QFileInfo info(dst);
+
+        if (!info.isDir()) {
+
+            //emit m_client->invokeCallback(callback);
+
+            return;
+        }
+
+        QList<uint64_t> ids;
+
+        for (QVariant it : items) {
+
+            ids.append(it.toULongLong());
+        }
+
+        if (!exportTree(ids, info.absoluteFilePath())) {
+
+            // TODO pass error to callback
+        }
+
+        emit m_backend->invokeCallback(callback);
+    });
+}
+
+/**
+ * @brief FileSystemModel::copyTree
+ * @param paths
+ * @param dst
+ * @return
+ */
+
+bool FileSystemModel::copyTree(const QStringList &paths, const QString &dst)
+{
+    // directories are created while walking, file contents are copied by the pool
+
+    QList<QPair<QString, QString>> files;
+
+    QQueue<QPair<QString, QString>> dirs;
+
+    quint64 bytesTotal = 0;
+
+    auto add = [&] (const QFileInfo &info, const QString &dir) {
+
+        QString path = QDir(dir).filePath(info.fileName());
+
+        if (info.isFile()) {
+
+            // files which already exist are kept
+
+            if (!QFileInfo(path).isFile()) {
+
+                files.append({info.absoluteFilePath(), path});
+
+                bytesTotal += info.size();
+            }
+
+            return true;
+        }
+
+        if (info.isDir()) {
+
+            if (dst == info.absoluteFilePath() || dst.startsWith(info.absoluteFilePath() + "/")) {
+
+                return false;
+            }
+
+            if (QFileInfo(path).exists() || !QDir(dir).mkdir(info.fileName())) {
+
+                return false;
+            }
+
+            dirs.enqueue({info.absoluteFilePath(), path});
+        }
+
+        return true;
+    };
+
+    for (auto &path : paths) {
+
+        if (!add(QFileInfo(path), dst)) {
+
+            return false;
+        }
+    }
+
+    while (!dirs.empty()) {
+
+        auto entry = dirs.dequeue();
+
+        for (auto &info : QDir(entry.first).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot)) {
+
+            if (!add(info, entry.second)) {
+
+                return false;
+            }
+        }
+    }
+
+    m_copyCancelled = 0;
+
+    std::atomic<quint64> bytesDone(0);
+
+    QAtomicInt failed(0);
+
+    QSemaphore done;
+
+    for (auto &file : files) {
+
+        m_copyPool.start(new LambdaRunnable([this, file, &bytesDone, &failed, &done] {
+
+            if (failed.load() || m_copyCancelled.load() || !copyFileData(file.first, file.second, bytesDone)) {
+
+                failed = 1;
+            }
+
+            done.release();
+        }));
+    }
+
+    QElapsedTimer timer;
+
+    timer.start();
+
+    auto report = [&] (quint32 filesDone) {
+
+        qint64 elapsed = timer.elapsed();
+
+        emit copyProgress(filesDone, files.size(), bytesDone, bytesTotal, elapsed ? bytesDone * 1000.0 / elapsed : 0);
+    };
+
+    while (!done.tryAcquire(files.size(), 250)) {
+
+        report(done.available());
+    }
+
+    report(files.size());
+
+    return !failed.load();
+}
+
+/**
+ * @brief FileSystemModel::copyFileData
+ * @param src
+ * @param dst
+ * @param bytesDone
+ * @return
+ */
+
+bool FileSystemModel::copyFileData(const QString &src, const QString &dst, std::atomic<quint64> &bytesDone)
+{
+    QFile in(src);
+
+    QFile out(dst);
+
+    if (!in.open(QFile::ReadOnly)) {
+
+        return false;
+    }
+
+    if (!out.open(QFile::WriteOnly)) {
+
+        return false;
+    }
+
+    qint64 size = in.size();
+
+    qint64 copied = 0;
+
+    bool res = false;
+
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+
+    // share the extents on btrfs and xfs, nothing has to be copied at all
+
+    if (ioctl(out.handle(), FICLONE, in.handle()) == 0) {
+
+        copied = size;
+
+        bytesDone += size;
+
+        res = true;
+    }
+
+#endif
+
+#if defined(Q_OS_LINUX) && defined(__NR_copy_file_range)
+
+    // let the kernel copy, stops at the first error and leaves the rest to the fallback
+
+    while (!res && copied < size && !m_copyCancelled.load()) {
+
+        loff_t offIn = copied;
+
+        loff_t offOut = copied;
+
+        ssize_t n = syscall(__NR_copy_file_range, in.handle(), &offIn, out.handle(), &offOut, qMin<qint64>(size - copied, m_copyChunkSize), 0);
+
+        if (n <= 0) {
+
+            break;
+        }
+
+        copied += n;
+
+        bytesDone += n;
+    }
+
+    res = res || copied == size;
+
+#endif
+
+    if (!res && !m_copyCancelled.load()) {
+
+        if (in.seek(copied) && out.seek(copied)) {
+
+            QByteArray buf(m_copyChunkSize, Qt::Uninitialized);
+
+            qint64 n;
+
+            while (!m_copyCancelled.load() && (n = in.read(buf.data(), buf.size())) > 0) {
+
+                if (out.write(buf.constData(), n) != n) {
+
+                    break;
+                }
+
+                copied += n;
+
+                bytesDone += n;
+            }
+        }
+
+        res = copied == size;
+    }
+
+    if (!res) {
+
+        out.remove();
+
+        return false;
     }
 
-    std::list<UBJ::Object> nodes;
+    out.setPermissions(in.permissions());
+
+    return true;
+}
+
+/**
+ * @brief FileSystemModel::setCopyThreads
+ * @param numThreads
+ */
+
+void FileSystemModel::setCopyThreads(qint32 numThreads)
+{
+    m_copyPool.setMaxThreadCount(qMax(numThreads, 1));
+}
+
+/**
+ * @brief FileSystemModel::exportTree
+ * @param ids
+ * @param dst
+ * @return
+ */
+
+bool FileSystemModel::exportTree(const QList<uint64_t> &ids, const QString &dst)
+{
+    // directories are created while walking, the blobs are exported by the pool
+
+    QList<QPair<uint64_t, QString>> files;
+
+    QQueue<QPair<uint64_t, QString>> dirs;
 
-    m_backend->store()->query("vfs", UBJ_OBJ("parent" << src), nodes, {}, {"rowid", "type"});
+    bool res = true;
 
-    for (auto &node : nodes) {
+    auto add = [&] (UBJ::Object &node, const QString &dir) {
+
+        QString path = QDir(dir).filePath(node["name"].toStr().c_str());
 
         if (node["type"].toInt() == Store::File) {
 
-            if (!copyResource(node["rowid"].toLong(), dir.absolutePath())) {
+            if (!QFileInfo(path).isFile()) {
 
-                //return false;
+                files.append({(uint64_t)node["data"].toLong(), path});
             }
         }
         else
         if (node["type"].toInt() == Store::Directory) {
 
-            if (!copyDirectory(node["rowid"].toLong(), dir.absolutePath(), recursive)) {
+            if (QFileInfo(path).exists() || !QDir(dir).mkdir(node["name"].toStr().c_str())) {
+
+                res = false;
+
+                return;
+            }
+
+            dirs.enqueue({(uint64_t)node["rowid"].toLong(), path});
+        }
+    };
+
+    for (auto id : ids) {
 
-                //return false;
+        UBJ::Object node;
+
+        if (m_backend->store()->query("vfs", UBJ_OBJ("rowid" << id), &node, {}, UBJ_ARR("rowid" << "type" << "name" << "data"))) {
+
+            add(node, dst);
+        }
+    }
+
+    while (!dirs.empty()) {
+
+        auto entry = dirs.dequeue();
+
+        std::list<UBJ::Object> nodes;
+
+        m_backend->store()->query("vfs", UBJ_OBJ("parent" << entry.first), nodes, {}, UBJ_ARR("rowid" << "type" << "name" << "data"));
+
+        for (auto &node : nodes) {
+
+            add(node, entry.second);
+        }
+    }
+
+    QSemaphore done;
+
+    QAtomicInt failed(0);
+
+    for (auto &file : files) {
+
+        m_exportPool.start(new LambdaRunnable([this, file, &done, &failed] {
+
+            if (!exportBlob(file.first, file.second)) {
+
+                failed = 1;
+            }
+
+            done.release();
+        }));
+    }
+
+    done.acquire(files.size());
+
+    return res && !failed.load();
+}
+
+/**
+ * @brief FileSystemModel::exportBlob
+ * @param blobId
+ * @param path
+ * @return
+ */
+
+bool FileSystemModel::exportBlob(uint64_t blobId, const QString &path)
+{
+    QFile file(path);
+
+    if (!file.open(QFile::WriteOnly)) {
+
+        return false;
+    }
+
+    uint32_t chunkSize = m_exportChunkSize;
+
+    bool success = false;
+
+    m_backend->store()->readBlob("blob3", blobId, [&] (bool error, UBJ::Store::Blob$ blob) {
+
+        if (error) {
+
+            return;
+        }
+
+        uint64_t size = blob->size();
+
+#ifdef Q_OS_LINUX
+
+        // reserve the space up front, a failure here only means the file grows as it is written
+
+        posix_fallocate(file.handle(), 0, size);
+
+#endif
+
+        // two buffers, the previous chunk is written to disk while the next one is read and decrypted
+
+        MemoryBuffer$ bufs[2] = {
+            MemoryBuffer::create(nullptr, chunkSize),
+            MemoryBuffer::create(nullptr, chunkSize)};
+
+        if (!bufs[0] || !bufs[1]) {
+
+            return;
+        }
+
+        ChunkPipe writer([&file] (MemoryBuffer$ buf, uint32_t numBytes, uint64_t) {
+
+            return file.write((const char*)buf->data(), numBytes) == numBytes;
+        });
+
+        uint64_t bytesRead = 0;
+
+        bool res = true;
+
+        for (uint32_t i = 0; res && bytesRead < size; i ^= 1) {
+
+            uint32_t bytesToRead = qMin<uint64_t>(chunkSize, size - bytesRead);
+
+            bufs[i]->clear();
+
+            // a short read or failed decrypt must never reach the disk
+
+            if (blob->read(bufs[i], bytesToRead, bytesRead) != bytesToRead) {
+
+                res = false;
+
+                break;
+            }
+
+            res = writer.wait();
+
+            if (res) {
+
+                writer.push(bufs[i], bytesToRead, bytesRead);
             }
+
+            bytesRead += bytesToRead;
         }
+
+        res = writer.wait() && res;
+
+        success = res;
+    });
+
+    file.close();
+
+    if (!success) {
+
+        file.remove();
+
+        return false;
     }
 
     return true;
 }
 
+/**
+ * @brief FileSystemModel::setExportChunkSize
+ * @param chunkSize
+ */
+
+void FileSystemModel::setExportChunkSize(quint32 chunkSize)
+{
+    m_exportChunkSize = qMax<quint32>(chunkSize, 4096);
+}
+
+/**
+ * @brief FileSystemModel::setExportThreads
+ * @param numThreads
+ */
+
+void FileSystemModel::setExportThreads(qint32 numThreads)
+{
+    m_exportPool.setMaxThreadCount(qMax(numThreads, 1));
+}
+
+/**
+ * @brief FileSystemModel::FileRow::fromInfo
+ * @param info
+ * @param mediaTypes
+ * @return
+ */
+
+FileSystemModel::FileRow FileSystemModel::FileRow::fromInfo(const QFileInfo &info, MediaTypes *mediaTypes)
+{
+    FileRow row;
+
+    row.m_path = info.absoluteFilePath();
+    row.m_name = info.fileName();
+
+    if (info.isDir()) {
+
+        row.m_type = 1;
+    }
+    else
+    if (info.isFile()) {
+
+        row.m_type = 2;
+
+        row.m_size = info.size();
+    }
+
+    row.m_time = info.lastModified().toMSecsSinceEpoch();
+
+    if (row.m_type == 2 && mediaTypes) {
+
+        row.m_mediaType = mediaTypes->fromFile(row.m_path, row.m_size, row.m_time);
+    }
+
+    // natural order key, digit runs are padded so "img10" sorts after "img9"
+
+    QString name = info.fileName().toCaseFolded();
+
+    row.m_sortName.reserve(name.size() + 16);
+
+    for (qint32 i = 0; i < name.size();) {
+
+        if (name[i].isDigit()) {
+
+            qint32 j = i;
+
+            while (j < name.size() && name[j].isDigit()) {
+
+                j++;
+            }
+
+            row.m_sortName += name.mid(i, j - i).rightJustified(20, '0');
+
+            i = j;
+        }
+        else {
+
+            row.m_sortName += name[i++];
+        }
+    }
+
+    return row;
+}
+
 /**
  * @brief FileSystemModel::roleNames
  * @return
@@ -668,6 +1722,8 @@ QHash<int, QByteArray> FileSystemModel::roleNames() const
     roles[TypeRole]   = "type";
     roles[NameRole]   = "name";
     roles[SizeRole]   = "size";
+    roles[TimeRole]   = "time";
+    roles[MediaTypeRole] = "mediaType";
     roles[OriginRole] = "origin";
 
     return roles;
@@ -31,6 +31,9 @@
 #include "backendbase.h"
 
 #include <QDebug>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QTextDocument>
 
 #include <Zway/message/resource.h>
 #include <Zway/store.h>
@@ -46,9 +49,26 @@
 HistoryModel::HistoryModel(BackendBase *backend, quint32 historyId) :
     QAbstractListModel(backend),
     m_backend(backend),
-    m_historyId(historyId)
+    m_historyId(historyId),
+    m_loaded(false),
+    m_windowBegin(0),
+    m_numMessagesTotal(0),
+    m_windowSeq(0),
+    m_loadingOlder(false),
+    m_loadingNewer(false),
+    m_fontPixelSize(0)
 {
+    // font size used by the message delegate, needed to measure message text off the gui thread
+
+    QJsonObject message = m_backend->theme()["HistoryView"].toObject()["Message"].toObject();
+
+    m_fontPixelSize = message["fontSize"].toDouble() * m_backend->sp();
+
     QObject::connect(this, &HistoryModel::updateView, this, &HistoryModel::onUpdateView);
+
+    QObject::connect(this, &HistoryModel::updateWindow, this, &HistoryModel::onUpdateWindow);
+
+    QObject::connect(this, &HistoryModel::insertItems, this, &HistoryModel::onInsertItems);
 }
 
 /**
@@ -93,6 +113,18 @@ QVariant HistoryModel::data(const QModelIndex &index, int role) const
             return item["time"];
         case TextRole:
             return item["text"];
+        case DisplayTextRole:
+            return item["displayText"];
+        case PlainTextRole:
+            return item["plainText"];
+        case TextWidthRole:
+            return item["textWidth"];
+        case TextHeightRole:
+            return item["textHeight"];
+        case NumResourcesRole:
+            return item["numResources"];
+        case ResourcesRole:
+            return resources(item);
     }
 
     return QVariant();
@@ -108,7 +140,11 @@ QVariant HistoryModel::get(int index)
 {
     if (index >= 0 && index < m_items.size()) {
 
-        return m_items[m_items.size() - index - 1];
+        QVariantMap item = m_items[m_items.size() - index - 1].toMap();
+
+        item["resources"] = resources(item);
+
+        return item;
     }
 
     return QVariant();
@@ -121,11 +157,33 @@ QVariant HistoryModel::get(int index)
 
 void HistoryModel::append(const QVariantMap &message)
 {
+    // released models pick the message up from the store when reloaded
+
+    if (!m_loaded) {
+
+        return;
+    }
+
+    // the window does not reach the newest message, it shows up when scrolled to
+
+    if (hasNewer()) {
+
+        m_numMessagesTotal++;
+
+        return;
+    }
+
+    QVariantMap item = message;
+
+    processText(item);
+
     beginInsertRows(QModelIndex(), 0, 0);
 
-    m_items.append(message);
+    m_items.append(item);
+
+    m_indexes[item["id"].toUInt()] = m_items.size() - 1;
 
-    m_indexes[message["id"].toUInt()] = m_items.size() - 1;
+    m_numMessagesTotal++;
 
     endInsertRows();
 }
@@ -143,7 +201,11 @@ void HistoryModel::update(const QVariantMap &message)
 
         quint32 i = m_indexes[messageId];
 
-        m_items[i] = message;
+        QVariantMap item = message;
+
+        processText(item);
+
+        m_items[i] = item;
 
         QModelIndex modelIndex = index(m_items.size() - i - 1);
 
@@ -167,6 +229,177 @@ qint32 HistoryModel::messageIndex(quint32 id)
     return -1;
 }
 
+/**
+ * @brief HistoryModel::messageRow
+ * @param id
+ * @return
+ */
+
+qint32 HistoryModel::messageRow(quint32 id)
+{
+    if (m_indexes.contains(id)) {
+
+        return m_items.size() - m_indexes[id] - 1;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief HistoryModel::loadAround
+ * @param messageId
+ * @param numItems
+ * @param callback
+ */
+
+void HistoryModel::loadAround(quint32 messageId, qint32 numItems, const QJSValue &callback)
+{
+    LambdaRunnable::start(
+        [this, messageId, numItems, callback] {
+
+            QList<Message$> messages = loadMessages();
+
+            qint32 pos = -1;
+
+            for (qint32 i=0; i<messages.size(); ++i) {
+
+                if (messages[i]->id() == messageId) {
+
+                    pos = i;
+
+                    break;
+                }
+            }
+
+            if (pos == -1) {
+
+                emit m_backend->invokeCallback(callback, {-1});
+
+                return;
+            }
+
+            // only messages inside the window get converted
+
+            qint32 begin = qMax(0, pos - numItems);
+
+            qint32 end = qMin(messages.size(), pos + numItems + 1);
+
+            QVariantList items;
+
+            for (qint32 i=begin; i<end; ++i) {
+
+                items.append(messageToVariant(messages[i]));
+            }
+
+            emit updateWindow(items, begin, messages.size());
+
+            emit m_backend->invokeCallback(callback, {end - pos - 1});
+        });
+}
+
+/**
+ * @brief HistoryModel::moreItems
+ * @param numItems
+ * @param older
+ * @param callback
+ */
+
+void HistoryModel::moreItems(qint32 numItems, bool older, const QJSValue &callback)
+{
+    // one request per direction, the view fires again once the rows are in
+
+    bool &loading = older ? m_loadingOlder : m_loadingNewer;
+
+    if (loading) {
+
+        emit m_backend->invokeCallback(callback, {0});
+
+        return;
+    }
+
+    loading = true;
+
+    qint32 windowBegin = m_windowBegin;
+
+    qint32 windowEnd = m_windowBegin + m_items.size();
+
+    quint32 seq = m_windowSeq;
+
+    LambdaRunnable::start(
+        [this, numItems, older, windowBegin, windowEnd, seq, callback] {
+
+            QList<Message$> messages = loadMessages();
+
+            qint32 begin = older ? qMax(0, windowBegin - numItems) : windowEnd;
+
+            qint32 end = older ? windowBegin : qMin(messages.size(), windowEnd + numItems);
+
+            QVariantList items;
+
+            for (qint32 i=begin; i<end; ++i) {
+
+                items.append(messageToVariant(messages[i]));
+            }
+
+            emit insertItems(items, older, messages.size(), begin, seq, callback);
+        });
+}
+
+/**
+ * @brief HistoryModel::hasOlder
+ * @return
+ */
+
+bool HistoryModel::hasOlder()
+{
+    return m_windowBegin > 0;
+}
+
+/**
+ * @brief HistoryModel::hasNewer
+ * @return
+ */
+
+bool HistoryModel::hasNewer()
+{
+    return m_windowBegin + m_items.size() < m_numMessagesTotal;
+}
+
+/**
+ * @brief HistoryModel::historyId
+ * @return
+ */
+
+quint32 HistoryModel::historyId()
+{
+    return m_historyId;
+}
+
+/**
+ * @brief HistoryModel::loaded
+ * @return
+ */
+
+bool HistoryModel::loaded()
+{
+    return m_loaded;
+}
+
+/**
+ * @brief HistoryModel::release
+ */
+
+void HistoryModel::release()
+{
+    clearItems();
+
+    m_loaded = false;
+
+    m_windowBegin = 0;
+
+    m_numMessagesTotal = 0;
+}
+
 /**
  * @brief HistoryModel::updateItems
  * @param callback
@@ -204,7 +437,25 @@ void HistoryModel::clearItems()
 
     m_indexes.clear();
 
+    m_windowSeq++;
+
+    m_loadingOlder = false;
+
+    m_loadingNewer = false;
+
     endResetModel();
+
+    {
+        QMutexLocker locker(&m_resourcesMutex);
+
+        m_pendingResources.clear();
+
+        m_resources.clear();
+    }
+
+    QMutexLocker locker(&m_textCacheMutex);
+
+    m_textCache.clear();
 }
 
 /**
@@ -213,11 +464,129 @@ void HistoryModel::clearItems()
  */
 
 void HistoryModel::onUpdateView(const QVariantList &items)
+{
+    onUpdateWindow(items, 0, items.size());
+}
+
+/**
+ * @brief HistoryModel::onUpdateWindow
+ * @param items
+ * @param offset
+ * @param total
+ */
+
+void HistoryModel::onUpdateWindow(const QVariantList &items, quint32 offset, quint32 total)
 {
     beginResetModel();
 
     m_items = items;
 
+    m_windowBegin = offset;
+
+    m_numMessagesTotal = total;
+
+    // pages requested for the previous window don't fit this one
+
+    m_windowSeq++;
+
+    m_loadingOlder = false;
+
+    m_loadingNewer = false;
+
+    updateIndexes();
+
+    endResetModel();
+
+    m_loaded = true;
+
+    m_backend->touchHistoryModel(m_historyId);
+}
+
+/**
+ * @brief HistoryModel::onInsertItems
+ * @param items
+ * @param older
+ * @param total
+ * @param begin
+ * @param seq
+ * @param callback
+ */
+
+void HistoryModel::onInsertItems(const QVariantList &items, bool older, quint32 total, quint32 begin, quint32 seq, const QJSValue &callback)
+{
+    if (seq != m_windowSeq) {
+
+        emit m_backend->invokeCallback(callback, {0});
+
+        return;
+    }
+
+    (older ? m_loadingOlder : m_loadingNewer) = false;
+
+    // the page must still border the window, appended messages move its newer end
+
+    bool fits = older ?
+                begin + items.size() == m_windowBegin :
+                begin == m_windowBegin + m_items.size();
+
+    if (!m_loaded || items.isEmpty() || !fits) {
+
+        emit m_backend->invokeCallback(callback, {0});
+
+        return;
+    }
+
+    // rows are in reverse order, older items go to the end of the view
+
+    if (older) {
+
+        beginInsertRows(QModelIndex(), m_items.size(), m_items.size() + items.size() - 1);
+
+        m_items = items + m_items;
+
+        m_windowBegin -= items.size();
+    }
+    else {
+
+        beginInsertRows(QModelIndex(), 0, items.size() - 1);
+
+        m_items += items;
+    }
+
+    m_numMessagesTotal = total;
+
+    updateIndexes();
+
+    endInsertRows();
+
+    m_backend->touchHistoryModel(m_historyId);
+
+    emit m_backend->invokeCallback(callback, {items.size()});
+}
+
+/**
+ * @brief HistoryModel::loadMessages
+ * @return
+ */
+
+QList<Message$> HistoryModel::loadMessages()
+{
+    QList<Message$> messages;
+
+    for (auto &message : m_backend->store()->getMessages(m_historyId)) {
+
+        messages.append(message);
+    }
+
+    return messages;
+}
+
+/**
+ * @brief HistoryModel::updateIndexes
+ */
+
+void HistoryModel::updateIndexes()
+{
     m_indexes.clear();
 
     auto index = 0;
@@ -228,8 +597,6 @@ void HistoryModel::onUpdateView(const QVariantList &items)
 
         m_indexes[message["id"].toUInt()] = index++;
     }
-
-    endResetModel();
 }
 
 /**
@@ -249,14 +616,20 @@ QVariantMap HistoryModel::messageToVariant(Message$ message)
     msg["time"]   = message->time();
     msg["text"]   = message->text().c_str();
 
-    QVariantList resources;
+    msg["numResources"] = message->numResources();
 
-    for (uint32_t i=0; i<message->numResources(); ++i) {
+    // resources are materialized when a row first asks for them
 
-        resources.append(resourceToVariant(message->resource(i)));
+    if (message->numResources()) {
+
+        QMutexLocker locker(&m_resourcesMutex);
+
+        m_resources.remove(message->id());
+
+        m_pendingResources[message->id()] = message;
     }
 
-    msg["resources"] = resources;
+    processText(msg);
 
     return msg;
 }
@@ -267,7 +640,7 @@ QVariantMap HistoryModel::messageToVariant(Message$ message)
  * @return
  */
 
-QVariantMap HistoryModel::resourceToVariant(Resource$ resource)
+QVariantMap HistoryModel::resourceToVariant(Resource$ resource) const
 {
     QVariantMap res;
 
@@ -279,6 +652,170 @@ QVariantMap HistoryModel::resourceToVariant(Resource$ resource)
     return res;
 }
 
+/**
+ * @brief HistoryModel::resources
+ * @param message
+ * @return
+ */
+
+QVariantList HistoryModel::resources(const QVariantMap &message) const
+{
+    // messages appended from events carry their resources already
+
+    if (message.contains("resources")) {
+
+        return message["resources"].toList();
+    }
+
+    quint32 messageId = message["id"].toUInt();
+
+    QMutexLocker locker(&m_resourcesMutex);
+
+    auto it = m_resources.find(messageId);
+
+    if (it != m_resources.end()) {
+
+        return *it;
+    }
+
+    QVariantList res;
+
+    Message$ msg = m_pendingResources.take(messageId);
+
+    if (msg) {
+
+        for (uint32_t i=0; i<msg->numResources(); ++i) {
+
+            res.append(resourceToVariant(msg->resource(i)));
+        }
+    }
+
+    m_resources[messageId] = res;
+
+    return res;
+}
+
+/**
+ * @brief HistoryModel::processText
+ * @param message
+ */
+
+void HistoryModel::processText(QVariantMap &message)
+{
+    quint32 messageId = message["id"].toUInt();
+
+    QString text = message["text"].toString();
+
+    TextLayout layout;
+
+    bool cached = false;
+
+    {
+        QMutexLocker locker(&m_textCacheMutex);
+
+        // text may have been rewritten (resource urls), so check it
+
+        auto it = m_textCache.find(messageId);
+
+        if (it != m_textCache.end() && it->m_text == text) {
+
+            layout = *it;
+
+            cached = true;
+        }
+    }
+
+    if (!cached) {
+
+        layout.m_text = text;
+
+        layout.m_displayText = processMessageText(text);
+
+        QTextDocument doc;
+
+        doc.setDocumentMargin(0);
+
+        QFont font = doc.defaultFont();
+
+        if (m_fontPixelSize > 0) {
+
+            font.setPixelSize(m_fontPixelSize);
+        }
+
+        doc.setDefaultFont(font);
+
+        doc.setHtml(layout.m_displayText);
+
+        layout.m_plainText = doc.toPlainText();
+
+        // images are resolved by the thumbs provider at display time,
+        // so leave measuring those messages to the delegate
+
+        if (!text.contains("<img", Qt::CaseInsensitive)) {
+
+            doc.setTextWidth(doc.idealWidth());
+
+            layout.m_width  = doc.idealWidth();
+            layout.m_height = doc.size().height();
+        }
+
+        QMutexLocker locker(&m_textCacheMutex);
+
+        m_textCache[messageId] = layout;
+    }
+
+    message["displayText"] = layout.m_displayText;
+    message["plainText"]   = layout.m_plainText;
+    message["textWidth"]   = layout.m_width;
+    message["textHeight"]  = layout.m_height;
+}
+
+/**
+ * @brief HistoryModel::processMessageText
+ * @param text
+ * @return
+ */
+
+QString HistoryModel::processMessageText(const QString &text)
+{
+    static const QRegularExpression linkRex("</a>(\\s*)</p>");
+
+    static const QRegularExpression styleRex("(font-family:'[^']+'|margin-\\w+:[^;]+);\\s*");
+
+    static const QRegularExpression fontSizeRex("font-size:([0-9]+)(?:px|pt)?;");
+
+    QString res = text;
+
+    // remove some stuff
+
+    res.replace(linkRex, "</a></p>");
+
+    res.replace(styleRex, "");
+
+    // adjust font size values
+
+    QString out;
+
+    qint32 pos = 0;
+
+    QRegularExpressionMatchIterator it = fontSizeRex.globalMatch(res);
+
+    while (it.hasNext()) {
+
+        QRegularExpressionMatch match = it.next();
+
+        out += res.mid(pos, match.capturedStart() - pos);
+
+        out += QString("font-size:%0px;").arg(qAbs(match.captured(1).toInt() * m_backend->sp()));
+
+        pos = match.capturedEnd();
+    }
+
+    out += res.mid(pos);
+
+    return out;
+}
+
 /**
  * @brief HistoryModel::roleNames
  * @return
@@ -288,12 +825,18 @@ QHash<int, QByteArray> HistoryModel::roleNames() const
 {
     QHash<int, QByteArray> roles;
 
-    roles[IdRole]       = "messageId";
-    roles[SrcRole]      = "messageSrc";
-    roles[DstRole]      = "messageDst";
-    roles[StatusRole]   = "messageStatus";
-    roles[TimeRole]     = "messageTime";
-    roles[TextRole]     = "messageText";
+    roles[IdRole]           = "messageId";
+    roles[SrcRole]          = "messageSrc";
+    roles[DstRole]          = "messageDst";
+    roles[StatusRole]       = "messageStatus";
+    roles[TimeRole]         = "messageTime";
+    roles[TextRole]         = "messageText";
+    roles[DisplayTextRole]  = "messageDisplayText";
+    roles[PlainTextRole]    = "messagePlainText";
+    roles[TextWidthRole]    = "messageTextWidth";
+    roles[TextHeightRole]   = "messageTextHeight";
+    roles[NumResourcesRole] = "messageNumResources";
+    roles[ResourcesRole]    = "messageResources";
 
     return roles;
 }
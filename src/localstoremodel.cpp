@@ -29,8 +29,15 @@
 
 #include "localstoremodel.h"
 #include "backendbase.h"
+#include "vfsnamecache.h"
+#include "chunkpipe.h"
 
 #include <QRegularExpression>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QThread>
 #include <QFileInfo>
 #include <QDir>
 
@@ -41,6 +48,12 @@
 
 // ============================================================ //
 
+/**
+ * @brief Parent of deleted nodes until they are reclaimed, no directory has this id
+ */
+
+static const uint32_t TrashDir = 0xFFFFFFFF;
+
 /**
  * @brief LocalStoreModel::LocalStoreModel
  * @param backend
@@ -50,9 +63,32 @@ LocalStoreModel::LocalStoreModel(BackendBase *backend) :
     QAbstractListModel(backend),
     m_backend(backend),
     m_currentDir(0),
-    m_numItemsTotal(0)
+    m_numItemsTotal(0),
+    m_numDirs(0),
+    m_numEntries(0),
+    m_offset(0),
+    m_mediaFilter(0),
+    m_seq(0),
+    m_loading(false),
+    m_pendingItems(0),
+    m_importChunkSize(4 * 1024 * 1024),
+    m_deleteProgressInterval(256),
+    m_sizeSeq(0),
+    m_deletePending(false),
+    m_deleteRunning(false),
+    m_deleteCancelled(0)
 {
+    QObject::connect(this, &LocalStoreModel::updateDir, this, &LocalStoreModel::onUpdateDir);
+
+    QObject::connect(this, &LocalStoreModel::insertItems, this, &LocalStoreModel::onInsertItems);
+
+    QObject::connect(this, &LocalStoreModel::dirSize, this, &LocalStoreModel::onDirSize);
+
+    QObject::connect(this, &LocalStoreModel::mediaTypeDetected, this, &LocalStoreModel::onMediaTypeDetected);
+
+    // one aggregation at a time, later ones reuse the sizes cached by earlier ones
 
+    m_sizePool.setMaxThreadCount(1);
 }
 
 /**
@@ -93,6 +129,8 @@ QVariant LocalStoreModel::data(const QModelIndex &index, int role) const {
             return item["name"];
         case SizeRole:
             return item["size"];
+        case MediaTypeRole:
+            return item["mediaType"];
         case OriginRole:
             return 2;
     }
@@ -138,26 +176,20 @@ bool LocalStoreModel::cd(quint32 dir)
 
     m_currentDir = dir;
 
-    std::list<UBJ::Object> items;
+    m_loading = true;
 
-    store->query("vfs", UBJ_OBJ("parent" << dir << "type" << Store::Directory), items, UBJ_OBJ("name" << 1), UBJ_ARR("rowid" << "*"));
+    // only count the entries here, pages are fetched on demand
 
-    store->query("vfs", UBJ_OBJ("parent" << dir << "type" << Store::File), items, UBJ_OBJ("name" << 1), UBJ_ARR("rowid" << "*"));
+    quint32 seq = m_seq;
 
-    for (auto &it : items) {
-
-        QVariantMap map;
+    LambdaRunnable::start([this, store, dir, seq] {
 
-        map["id"]   = it["rowid"].toInt();
-        map["type"] = it["type"].toInt();
-        map["name"] = it["name"].toStr().c_str();
-        map["data"] = it["data"].toInt();
-        map["origin"] = 2;
+        quint32 numDirs = store->count("vfs", UBJ_OBJ("parent" << dir << "type" << Store::Directory));
 
-        m_itemsFull.append(map);
-    }
+        quint32 numFiles = store->count("vfs", UBJ_OBJ("parent" << dir << "type" << Store::File));
 
-    m_numItemsTotal = m_itemsFull.size();
+        emit updateDir(seq, numDirs, numFiles);
+    });
 
     return true;
 }
@@ -171,450 +203,1497 @@ bool LocalStoreModel::cd(quint32 dir)
 
 bool LocalStoreModel::moreItems(qint32 numItems, const QJSValue &callback)
 {
-    if (!m_itemsFull.empty()) {
+    if (!m_loading && (quint32)m_items.size() >= m_numItemsTotal) {
 
-        qint32 num = numItems;
+        return false;
+    }
 
-        if (num > m_itemsFull.size()) {
+    // requests made while a page is loading are merged into the next one
 
-            num = m_itemsFull.size();
-        }
+    m_pendingItems += numItems;
 
-        beginInsertRows(QModelIndex(), m_items.size(), m_items.size() + num - 1);
+    if (callback.isCallable()) {
 
-        QList<QVariantMap>::iterator a = m_itemsFull.begin();
-        QList<QVariantMap>::iterator b = m_itemsFull.begin() + num;
+        m_pendingCallbacks.append(callback);
+    }
 
-        std::move(a, b, std::back_inserter(m_items));
+    if (!m_loading) {
 
-        m_itemsFull.erase(a, b);
+        loadPage();
+    }
 
-        endInsertRows();
+    return true;
+}
 
-        QJSValue cb(callback);
+/**
+ * @brief LocalStoreModel::onUpdateDir
+ * @param seq
+ * @param numDirs
+ * @param numFiles
+ */
 
-        if (cb.isCallable()) {
+void LocalStoreModel::onUpdateDir(quint32 seq, quint32 numDirs, quint32 numFiles)
+{
+    if (seq != m_seq) {
 
-            QJSValueList args;
+        return;
+    }
 
-            args.append(num);
+    m_numDirs = numDirs;
 
-            cb.call(args);
-        }
+    m_numEntries = numDirs + numFiles;
 
-        return true;
-    }
+    // with a media filter this is an upper bound until the last page is in
 
-    return false;
-}
+    m_numItemsTotal = m_numEntries;
 
-/**
- * @brief LocalStoreModel::currentDir
- * @return
- */
+    m_loading = false;
 
-quint32 LocalStoreModel::currentDir()
-{
-    return m_currentDir;
-}
+    emit numItemsTotalChanged();
 
-/**
- * @brief LocalStoreModel::numItemsTotal
- * @return
- */
+    if (m_pendingItems > 0) {
 
-quint32 LocalStoreModel::numItemsTotal()
-{
-    return m_numItemsTotal;
+        loadPage();
+    }
 }
 
 /**
- * @brief LocalStoreModel::clear
+ * @brief LocalStoreModel::onInsertItems
+ * @param seq
+ * @param offset
+ * @param items
+ * @param next
  */
 
-void LocalStoreModel::clear()
+void LocalStoreModel::onInsertItems(quint32 seq, qint32 offset, const QVariantList &items, quint32 next)
 {
-    beginResetModel();
-
-    m_currentDir = 0;
+    if (seq != m_seq || offset != m_items.size()) {
 
-    m_itemsFull.clear();
+        return;
+    }
 
-    m_items.clear();
+    m_loading = false;
 
-    endResetModel();
-}
+    m_offset = next;
 
-/**
- * @brief LocalStoreModel::createDirectory
- * @param name
- * @param parent
- * @param callback
- */
+    if (!items.empty()) {
 
-void LocalStoreModel::createDirectory(const QString &name, quint32 parent, const QJSValue &callback)
-{
-    LambdaRunnable::start([this, name, parent, callback] {
+        beginInsertRows(QModelIndex(), m_items.size(), m_items.size() + items.size() - 1);
 
-        if (!m_backend->store()->createVfsNode(Store::Directory, name.toStdString(), parent)) {
+        for (auto &it : items) {
 
-            // ...
+            m_items.append(it.toMap());
         }
 
-        emit m_backend->invokeCallback(callback);
-    });
-}
+        endInsertRows();
+    }
 
-/**
- * @brief LocalStoreModel::deleteItems
- * @param items
- * @param callback
- */
+    // every request merged into this page gets its answer
 
-void LocalStoreModel::deleteItems(const QVariantList &items, const QJSValue &callback)
-{
-    LambdaRunnable::start([this, items, callback] {
+    invokeCallbacks(m_loadingCallbacks, items.size());
 
-        for (QVariant it : items) {
+    // fewer rows than expected means the directory shrank meanwhile or the filter dropped some
 
-            quint32 id = it.toUInt();
+    if ((quint32)m_items.size() < m_numItemsTotal && (items.empty() || m_offset >= m_numEntries)) {
 
-            if (!m_backend->store()->deleteVfsNode(id)) {
+        m_numItemsTotal = m_items.size();
 
-                // ...
-            }
-        }
+        emit numItemsTotalChanged();
+    }
 
-        emit m_backend->invokeCallback(callback);
-    });
+    if (m_pendingItems > 0 && (quint32)m_items.size() < m_numItemsTotal) {
+
+        loadPage();
+    }
 }
 
 /**
- * @brief LocalStoreModel::pasteFromFileSystem
- * @param items
- * @param dst
- * @param callback
+ * @brief LocalStoreModel::loadPage
  */
 
-void LocalStoreModel::pasteFromFileSystem(const QVariantList &items, quint32 dst, const QJSValue &callback)
+void LocalStoreModel::loadPage()
 {
-    LambdaRunnable::start([this, items, dst, callback] {
+    qint32 offset = m_items.size();
 
-        // get dst node
+    qint32 limit = m_pendingItems;
 
-        if (dst) {
+    m_pendingItems = 0;
 
-            if (!m_backend->store()->count(
-                        "vfs",
-                        UBJ_OBJ(
-                            "rowid" << dst <<
-                            "type"  << Store::Directory))) {
+    m_loadingCallbacks.append(m_pendingCallbacks);
 
-                // TODO pass error to callback
+    m_pendingCallbacks.clear();
 
-                emit m_backend->invokeCallback(callback);
+    if (limit <= 0 || (quint32)offset >= m_numItemsTotal || m_offset >= m_numEntries) {
 
-                return;
-            }
-        }
+        invokeCallbacks(m_loadingCallbacks, 0);
 
-        // process items to paste
+        return;
+    }
 
-        for (QVariant it : items) {
+    m_loading = true;
 
-            QFileInfo info(it.toString());
+    quint32 seq = m_seq;
 
-            if (info.isFile()) {
+    quint32 dir = m_currentDir;
 
-                if (!copyFile(info.absoluteFilePath(), dst)) {
+    quint32 numDirs = m_numDirs;
 
-                    // TODO pass error to callback
+    quint32 numEntries = m_numEntries;
 
-                    emit m_backend->invokeCallback(callback);
+    quint32 from = m_offset;
 
-                    return;
-                }
-            }
-            else
-            if (info.isDir()) {
+    qint32 mediaType = m_mediaFilter;
 
-                if (!copyDirectory(info.absoluteFilePath(), dst)) {
+    LambdaRunnable::start([this, seq, dir, numDirs, numEntries, from, offset, limit, mediaType] {
 
-                    // TODO pass error to callback
+        quint32 next = from;
 
-                    emit m_backend->invokeCallback(callback);
+        QVariantList items = filterItems(dir, numDirs, numEntries, next, limit, mediaType);
 
-                    return;
-                }
-            }
-        }
+        emit insertItems(seq, offset, items, next);
 
-        emit m_backend->invokeCallback(callback);
+        aggregateDirs(seq, items);
     });
 }
 
 /**
- * @brief LocalStoreModel::pasteFromLocalStore
- * @param items
- * @param dst
- * @param callback
+ * @brief LocalStoreModel::invokeCallbacks
+ * @param callbacks
+ * @param numItems
  */
 
-void LocalStoreModel::pasteFromLocalStore(const QVariantList &items, quint32 dst, const QJSValue &callback)
+void LocalStoreModel::invokeCallbacks(QList<QJSValue> &callbacks, qint32 numItems)
 {
-    LambdaRunnable::start([this, items, dst, callback] {
-
-        for (QVariant it : items) {
-
-            UBJ::Object node;
+    QList<QJSValue> cbs;
 
-            if (m_backend->store()->query("vfs", UBJ_OBJ("rowid" << (uint64_t)it.toULongLong()), &node, {}, {"type"})) {
-
-                if (node["type"].toInt() == Store::File) {
-
-                    if (!copyResource(it.toULongLong(), dst)) {
-
-                        // TODO pass error to callback
-
-                        //emit m_backend->invokeCallback(callback);
+    cbs.swap(callbacks);
 
-                        //return;
-                    }
-                }
-                else
-                if (node["type"].toInt() == Store::Directory) {
-
-                    if (!copyDirectory(it.toULongLong(), dst)) {
+    for (auto &callback : cbs) {
 
-                        // TODO passs error to callback
+        QJSValue cb(callback);
 
-                        //emit m_backend->invokeCallback(callback);
+        QJSValueList args;
 
-                        //return;
-                    }
-                }
-            }
-        }
+        args.append(numItems);
 
-        emit m_backend->invokeCallback(callback);
-    });
+        cb.call(args);
+    }
 }
 
 /**
- * @brief LocalStoreModel::copyFile
- * @param src
- * @param dst
- * @return
+ * @brief LocalStoreModel::aggregateDirs
+ * @param seq
+ * @param items
  */
 
-bool LocalStoreModel::copyFile(const QString &src, uint64_t dst)
+void LocalStoreModel::aggregateDirs(quint32 seq, const QVariantList &items)
 {
-    QFileInfo info(src);
-
-    Resource$ file = FileSystemResource::create(info.absoluteFilePath().toStdString());
+    QList<uint64_t> dirs;
 
-    if (!file || !file->open()) {
-
-        return false;
-    }
+    for (auto &it : items) {
 
-    uint64_t blobId = m_backend->store()->createBlob("blob3", file->size());
+        QVariantMap map = it.toMap();
 
-    if (!blobId) {
+        if (map["type"].toInt() == Store::Directory && !map.contains("size")) {
 
-        return false;
+            dirs.append(map["id"].toULongLong());
+        }
     }
 
-    m_backend->store()->writeBlob("blob3", blobId, [&info, &file] (bool error, UBJ::Store::Blob$ blob) {
-
-        if (!error) {
+    if (dirs.empty()) {
 
-            uint32_t blockSize = 4096;
+        return;
+    }
 
-            uint32_t bytesWritten = 0;
+    m_sizePool.start(new LambdaRunnable([this, seq, dirs] {
 
-            MemoryBuffer$ buf = MemoryBuffer::create(nullptr, blockSize);
+        for (auto dirId : dirs) {
 
-            if (!buf) {
+            if ((quint32)m_sizeSeq.load() != seq) {
 
                 return;
             }
 
-            while (bytesWritten < file->size()) {
+            DirSizes::Entry entry = m_backend->dirSizes().aggregate(m_backend->store(), dirId);
 
-                uint32_t bytesToWrite = blockSize;
+            emit dirSize(seq, dirId, entry.m_size, entry.m_numItems);
+        }
+    }));
+}
 
-                if (file->size() - bytesWritten < blockSize) {
+/**
+ * @brief LocalStoreModel::onDirSize
+ * @param seq
+ * @param dirId
+ * @param size
+ * @param numItems
+ */
 
-                    bytesToWrite = file->size() - bytesWritten;
-                }
+void LocalStoreModel::onDirSize(quint32 seq, quint32 dirId, quint64 size, quint32 numItems)
+{
+    if (seq != m_seq) {
 
-                file->read(buf, bytesToWrite, bytesWritten);
+        return;
+    }
 
-                blob->write(buf, bytesToWrite, bytesWritten);
+    // directories come first, so the search ends with the first file
 
-                bytesWritten += bytesToWrite;
+    for (qint32 i = 0; i < m_items.size() && m_items[i]["type"].toInt() == Store::Directory; ++i) {
 
-                buf->clear();
-            }
-        }
-    });
+        if (m_items[i]["id"].toUInt() == dirId) {
 
-    if (!m_backend->store()->createVfsNode(
-                Store::File,
-                info.fileName().toStdString(),
-                dst,
-                UBJ_OBJ(
-                    "size" << file->size() <<
-                    "hash" << file->hash() <<
-                    "data" << blobId))) {
+            m_items[i]["size"] = size;
 
-        return false;
-    }
+            m_items[i]["numItems"] = numItems;
 
-    return true;
+            emit dataChanged(index(i), index(i), {SizeRole});
+
+            break;
+        }
+    }
 }
 
 /**
- * @brief LocalStoreModel::copyDirectory
- * @param src
- * @param dst
- * @param recursive
+ * @brief LocalStoreModel::queryItems
+ * @param dir
+ * @param numDirs
+ * @param offset
+ * @param limit
+ * @param mediaTypes
  * @return
  */
 
-bool LocalStoreModel::copyDirectory(const QString &src, uint64_t dst, bool recursive)
+QVariantList LocalStoreModel::queryItems(quint32 dir, quint32 numDirs, qint32 offset, qint32 limit, bool mediaTypes)
 {
-    QDir dir(src);
+    QVariantList res;
 
-    if (m_backend->store()->count(
-                "vfs",
-                UBJ_OBJ(
-                    "name"   << dir.dirName().toStdString() <<
-                    "type"   << Store::Directory <<
-                    "parent" << dst))) {
+    auto fetch = [&] (qint32 type, qint32 from, qint32 count) {
 
-        return false;
-    }
+        m_backend->store()->query(
+                    "vfs", UBJ_OBJ("parent" << dir << "type" << type), UBJ_OBJ("name" << 1), UBJ_ARR("rowid" << "*"), count, from,
+                    [&] (bool error, UBJ::Store::Cursor$ cursor) {
 
-    uint64_t dirId = m_backend->store()->createVfsNode(Store::Directory, dir.dirName().toStdString(), dst);
+            if (!error) {
 
-    if (!dirId) {
+                cursor->forEach([&] (UBJ::Object &it) {
 
-        return false;
-    }
+                    QVariantMap map;
 
-    QFileInfoList files = dir.entryInfoList(QDir::NoFilter, QDir::DirsFirst);
+                    map["id"]   = it["rowid"].toInt();
+                    map["type"] = it["type"].toInt();
+                    map["name"] = it["name"].toStr().c_str();
+                    map["data"] = it["data"].toInt();
+                    map["hash"] = it["hash"].toStr().c_str();
 
-    for (auto &file : files) {
+                    if (type == Store::File) {
 
-        if (file.fileName() == "." || file.fileName() == "..") {
+                        map["size"] = (qulonglong)it["size"].toLong();
+                    }
 
-            continue;
-        }
+                    map["origin"] = 2;
 
-        if (file.isFile()) {
+                    res.append(map);
+                });
+            }
+        });
+    };
 
-            if (!copyFile(file.absoluteFilePath(), dirId)) {
+    // directories come first, so a page may span both queries
 
-                return false;
-            }
-        }
-        else
-        if (file.isDir()) {
+    if ((quint32)offset < numDirs) {
 
-            if (!copyDirectory(file.absoluteFilePath(), dirId, recursive)) {
+        qint32 num = qMin<qint32>(limit, numDirs - offset);
 
-                return false;
-            }
-        }
+        fetch(Store::Directory, offset, num);
+
+        offset += num;
+
+        limit -= num;
     }
 
-    return true;
-}
+    if (limit > 0) {
 
-/**
- * @brief LocalStoreModel::copyResource
- * @param src
- * @param dst
- * @return
- */
+        fetch(Store::File, offset - numDirs, limit);
+    }
 
-bool LocalStoreModel::copyResource(uint64_t src, uint64_t dst)
-{
-    UBJ::Object node;
+    // filled in once the cursors are closed, a media type needs a blob read and is only fetched here
+    // for filtering, otherwise once the row is shown, directories without a cached size are aggregated
+    // after the page is shown
 
-    if (!m_backend->store()->query("vfs", UBJ_OBJ("rowid" << src), &node)) {
+    for (auto &it : res) {
 
-        return false;
-    }
+        QVariantMap map = it.toMap();
 
-    if (m_backend->store()->count("vfs", UBJ_OBJ("name" << node["name"] << "parent" << dst))) {
+        if (map["type"].toInt() == Store::File) {
 
-        return false;
-    }
+            map["mediaType"] = mediaTypes ? m_backend->mediaTypes().fromBlob(
+                        m_backend->store(), map["data"].toULongLong(), map["hash"].toString().toStdString()) : MediaTypes::Unknown;
+        }
+        else {
 
-    if (!m_backend->store()->createVfsNode(Store::File, node["name"].toStr(), dst, node)) {
+            DirSizes::Entry entry;
 
-        return false;
+            if (m_backend->dirSizes().get(map["id"].toULongLong(), entry)) {
+
+                map["size"] = (qulonglong)entry.m_size;
+
+                map["numItems"] = entry.m_numItems;
+            }
+        }
+
+        it = map;
     }
 
-    return true;
+    return res;
 }
 
 /**
- * @brief LocalStoreModel::copyDirectory
- * @param src
- * @param dst
- * @param recursive
+ * @brief LocalStoreModel::filterItems
+ * @param dir
+ * @param numDirs
+ * @param numEntries
+ * @param offset
+ * @param limit
+ * @param mediaType
  * @return
  */
 
-bool LocalStoreModel::copyDirectory(uint64_t src, uint64_t dst, bool recursive)
+QVariantList LocalStoreModel::filterItems(quint32 dir, quint32 numDirs, quint32 numEntries, quint32 &offset, qint32 limit, qint32 mediaType)
 {
-    if (src == dst) {
-
-        return false;
-    }
-
-    UBJ::Object node;
+    if (!mediaType) {
 
-    if (!m_backend->store()->query("vfs", UBJ_OBJ("rowid" << src), &node)) {
-
-        return false;
-    }
+        QVariantList res = queryItems(dir, numDirs, offset, limit);
 
-    if (m_backend->store()->count("vfs", UBJ_OBJ("name" << node["name"] << "parent" << dst))) {
+        offset += res.size();
 
-        return false;
+        return res;
     }
 
-    uint64_t dirId = m_backend->store()->createVfsNode(Store::Directory, node["name"].toStr(), dst);
+    // the store can't filter by content, so pages are read until enough rows match
 
-    if (!dirId) {
+    QVariantList res;
 
-        return false;
-    }
+    while (res.size() < limit && offset < numEntries) {
 
-    std::list<UBJ::Object> nodes;
+        QVariantList items = queryItems(dir, numDirs, offset, limit, true);
 
-    m_backend->store()->query("vfs", UBJ_OBJ("parent" << src), nodes, {}, {"rowid", "type"});
+        if (items.empty()) {
 
-    for (auto &node : nodes) {
+            break;
+        }
 
-        if (node["type"].toInt() == Store::File) {
+        offset += items.size();
 
-            if (!copyResource(node["rowid"].toLong(), dirId)) {
+        for (auto &it : items) {
 
-                //return false;
-            }
-        }
-        else
-        if (node["type"].toInt() == Store::Directory) {
+            QVariantMap map = it.toMap();
 
-            if (!copyDirectory(node["rowid"].toLong(), dirId, recursive)) {
+            if (map["type"].toInt() == Store::Directory || map["mediaType"].toInt() == mediaType) {
 
-                //return false;
+                res.append(map);
+            }
+        }
+    }
+
+    return res;
+}
+
+/**
+ * @brief LocalStoreModel::setMediaFilter
+ * @param mediaType
+ */
+
+void LocalStoreModel::setMediaFilter(qint32 mediaType)
+{
+    m_mediaFilter = mediaType;
+}
+
+/**
+ * @brief LocalStoreModel::detectMediaType
+ * @param index
+ * @param callback
+ */
+
+void LocalStoreModel::detectMediaType(qint32 index, const QJSValue &callback)
+{
+    if (index < 0 || index >= m_items.size() ||
+        m_items[index]["type"].toInt() != Store::File || m_items[index]["mediaType"].toInt() != MediaTypes::Unknown) {
+
+        QJSValue cb(callback);
+
+        if (cb.isCallable()) {
+
+            cb.call({index >= 0 && index < m_items.size() ? m_items[index]["mediaType"].toInt() : (qint32)MediaTypes::Unknown});
+        }
+
+        return;
+    }
+
+    // the blob header is read once the row is shown, the cache makes later pages cheap
+
+    quint32 seq = m_seq;
+
+    quint32 id = m_items[index]["id"].toUInt();
+
+    uint64_t blobId = m_items[index]["data"].toULongLong();
+
+    std::string hash = m_items[index]["hash"].toString().toStdString();
+
+    LambdaRunnable::start([this, seq, index, id, blobId, hash, callback] {
+
+        qint32 mediaType = m_backend->mediaTypes().fromBlob(m_backend->store(), blobId, hash);
+
+        emit mediaTypeDetected(seq, index, id, mediaType, callback);
+    });
+}
+
+/**
+ * @brief LocalStoreModel::onMediaTypeDetected
+ * @param seq
+ * @param index
+ * @param id
+ * @param mediaType
+ * @param callback
+ */
+
+void LocalStoreModel::onMediaTypeDetected(quint32 seq, qint32 index, quint32 id, qint32 mediaType, const QJSValue &callback)
+{
+    if (seq == m_seq) {
+
+        // rows may have been inserted before it meanwhile
+
+        if (index >= m_items.size() || m_items[index]["id"].toUInt() != id) {
+
+            index = -1;
+
+            for (qint32 i = 0; i < m_items.size(); ++i) {
+
+                if (m_items[i]["id"].toUInt() == id) {
+
+                    index = i;
+
+                    break;
+                }
+            }
+        }
+
+        if (index >= 0) {
+
+            m_items[index]["mediaType"] = mediaType;
+
+            emit dataChanged(this->index(index), this->index(index), {MediaTypeRole});
+        }
+    }
+
+    QJSValue cb(callback);
+
+    if (cb.isCallable()) {
+
+        cb.call({mediaType});
+    }
+}
+
+/**
+ * @brief LocalStoreModel::currentDir
+ * @return
+ */
+
+quint32 LocalStoreModel::currentDir()
+{
+    return m_currentDir;
+}
+
+/**
+ * @brief LocalStoreModel::numItemsTotal
+ * @return
+ */
+
+quint32 LocalStoreModel::numItemsTotal()
+{
+    return m_numItemsTotal;
+}
+
+/**
+ * @brief LocalStoreModel::setImportChunkSize
+ * @param chunkSize
+ */
+
+void LocalStoreModel::setImportChunkSize(quint32 chunkSize)
+{
+    m_importChunkSize = qMax<quint32>(chunkSize, 4096);
+}
+
+/**
+ * @brief LocalStoreModel::setDeleteProgressInterval
+ * @param interval number of reclaimed nodes between progress reports
+ */
+
+void LocalStoreModel::setDeleteProgressInterval(quint32 interval)
+{
+    m_deleteProgressInterval = qMax<quint32>(interval, 1);
+}
+
+/**
+ * @brief LocalStoreModel::clear
+ */
+
+void LocalStoreModel::clear()
+{
+    beginResetModel();
+
+    m_currentDir = 0;
+
+    m_numItemsTotal = 0;
+
+    m_numDirs = 0;
+
+    m_numEntries = 0;
+
+    m_offset = 0;
+
+    // pages still in flight belong to the old listing
+
+    m_seq++;
+
+    m_sizeSeq.store(m_seq);
+
+    m_loading = false;
+
+    m_pendingItems = 0;
+
+    QList<QJSValue> callbacks = m_loadingCallbacks + m_pendingCallbacks;
+
+    m_loadingCallbacks.clear();
+
+    m_pendingCallbacks.clear();
+
+    m_items.clear();
+
+    endResetModel();
+
+    // callers waiting for a page of the old listing are released
+
+    invokeCallbacks(callbacks, 0);
+}
+
+/**
+ * @brief LocalStoreModel::createDirectory
+ * @param name
+ * @param parent
+ * @param callback
+ */
+
+void LocalStoreModel::createDirectory(const QString &name, quint32 parent, const QJSValue &callback)
+{
+    LambdaRunnable::start([this, name, parent, callback] {
+
+        uint64_t dirId = m_backend->store()->createVfsNode(Store::Directory, name.toStdString(), parent);
+
+        if (!dirId) {
+
+            // ...
+        }
+        else {
+
+            // the new directory is cached as empty so the parent stays fully cached
+
+            m_backend->dirSizes().adjust(m_backend->store(), parent, 0, 1);
+
+            m_backend->dirSizes().aggregate(m_backend->store(), dirId);
+        }
+
+        emit m_backend->invokeCallback(callback);
+    });
+}
+
+/**
+ * @brief LocalStoreModel::deleteItems
+ * @param items
+ * @param callback
+ */
+
+void LocalStoreModel::deleteItems(const QVariantList &items, const QJSValue &callback)
+{
+    LambdaRunnable::start([this, items, callback] {
+
+        for (QVariant it : items) {
+
+            if (!detachNode(it.toULongLong())) {
+
+                // ...
+            }
+        }
+
+        // the items are gone from every listing, the rest is cleaned up in the background
+
+        emit m_backend->invokeCallback(callback);
+
+        bool start;
+
+        {
+            QMutexLocker locker(&m_deleteMutex);
+
+            m_deletePending = true;
+
+            start = !m_deleteRunning;
+
+            m_deleteRunning = true;
+
+            m_deleteCancelled = 0;
+        }
+
+        if (start) {
+
+            reclaimNodes();
+        }
+    });
+}
+
+/**
+ * @brief LocalStoreModel::cancelDelete
+ */
+
+void LocalStoreModel::cancelDelete()
+{
+    m_deleteCancelled = 1;
+}
+
+/**
+ * @brief LocalStoreModel::resumeDelete
+ */
+
+void LocalStoreModel::resumeDelete()
+{
+    LambdaRunnable::start([this] {
+
+        // a trash left by a cancelled job or a crash is reclaimed once the store is open again
+
+        if (!m_backend->store()->count("vfs", UBJ_OBJ("parent" << TrashDir))) {
+
+            return;
+        }
+
+        bool start;
+
+        {
+            QMutexLocker locker(&m_deleteMutex);
+
+            m_deletePending = true;
+
+            start = !m_deleteRunning;
+
+            m_deleteRunning = true;
+
+            m_deleteCancelled = 0;
+        }
+
+        if (start) {
+
+            reclaimNodes();
+        }
+    });
+}
+
+/**
+ * @brief LocalStoreModel::pasteFromFileSystem
+ * @param items
+ * @param dst
+ * @param callback
+ */
+
+void LocalStoreModel::pasteFromFileSystem(const QVariantList &items, quint32 dst, const QJSValue &callback)
+{
+    LambdaRunnable::start([this, items, dst, callback] {
+
+        // get dst node
+
+        if (dst) {
+
+            if (!m_backend->store()->count(
+                        "vfs",
+                        UBJ_OBJ(
+                            "rowid" << dst <<
+                            "type"  << Store::Directory))) {
+
+                // TODO pass error to callback
+
+                emit m_backend->invokeCallback(callback);
+
+                return;
+            }
+        }
+
+        // process items to paste
+
+        QStringList paths;
+
+        for (QVariant it : items) {
+
+            paths.append(it.toString());
+        }
+
+        if (!importTree(paths, dst)) {
+
+            // TODO pass error to callback
+        }
+
+        m_backend->dirSizes().invalidate(m_backend->store(), dst);
+
+        emit m_backend->invokeCallback(callback);
+    });
+}
+
+/**
+ * @brief LocalStoreModel::pasteFromLocalStore
+ * @param items
+ * @param dst
+ * @param callback
+ */
+
+void LocalStoreModel::pasteFromLocalStore(const QVariantList &items, quint32 dst, const QJSValue &callback)
+{
+    LambdaRunnable::start([this, items, dst, callback] {
+
+        VfsNameCache names(m_backend->store());
+
+        for (QVariant it : items) {
+
+            UBJ::Object node;
+
+            if (m_backend->store()->query("vfs", UBJ_OBJ("rowid" << (uint64_t)it.toULongLong()), &node, {}, {"type"})) {
+
+                if (node["type"].toInt() == Store::File) {
+
+                    if (!copyResource(it.toULongLong(), dst, names)) {
+
+                        // TODO pass error to callback
+
+                        //emit m_backend->invokeCallback(callback);
+
+                        //return;
+                    }
+                }
+                else
+                if (node["type"].toInt() == Store::Directory) {
+
+                    if (!copyDirectory(it.toULongLong(), dst, names)) {
+
+                        // TODO passs error to callback
+
+                        //emit m_backend->invokeCallback(callback);
+
+                        //return;
+                    }
+                }
+            }
+        }
+
+        m_backend->dirSizes().invalidate(m_backend->store(), dst);
+
+        emit m_backend->invokeCallback(callback);
+    });
+}
+
+/**
+ * @brief LocalStoreModel::importTree
+ * @param paths
+ * @param dst
+ * @return
+ */
+
+bool LocalStoreModel::importTree(const QStringList &paths, uint64_t dst)
+{
+    // the calling thread walks the tree and is the only one inserting vfs nodes,
+    // files are hashed and written into blobs by the import pool
+
+    QMutex mutex;
+
+    QWaitCondition finishedCond;
+
+    QList<ImportItem> finished;
+
+    quint32 numStarted = 0;
+
+    quint32 numFinished = 0;
+
+    bool failed = false;
+
+    quint32 filesTotal = 0;
+
+    quint32 filesDone = 0;
+
+    quint64 bytesTotal = 0;
+
+    quint64 bytesDone = 0;
+
+    VfsNameCache names(m_backend->store());
+
+    QElapsedTimer timer;
+
+    timer.start();
+
+    qint64 lastReport = -1;
+
+    auto report = [&] (bool force) {
+
+        qint64 elapsed = timer.elapsed();
+
+        if (force || lastReport < 0 || elapsed - lastReport >= 250) {
+
+            lastReport = elapsed;
+
+            emit importProgress(filesDone, filesTotal, bytesDone, bytesTotal, elapsed ? bytesDone * 1000.0 / elapsed : 0);
+        }
+    };
+
+    auto start = [&] (const QFileInfo &info, uint64_t parent) {
+
+        ImportItem item;
+
+        item.m_path   = info.absoluteFilePath();
+        item.m_name   = info.fileName().toStdString();
+        item.m_parent = parent;
+
+        filesTotal++;
+
+        bytesTotal += info.size();
+
+        numStarted++;
+
+        m_importPool.start(new LambdaRunnable([&, item] () mutable {
+
+            bool skip;
+
+            {
+                QMutexLocker locker(&mutex);
+
+                skip = failed;
+            }
+
+            bool res = !skip && importFile(item);
+
+            QMutexLocker locker(&mutex);
+
+            if (res) {
+
+                finished.append(item);
+            }
+            else {
+
+                failed = true;
+            }
+
+            numFinished++;
+
+            finishedCond.wakeAll();
+        }));
+    };
+
+    // an imported file without a node gives back its reference, a blob nobody else shares is removed
+
+    auto discard = [&] (const ImportItem &item) {
+
+        if (item.m_blobId && m_backend->blobIndex().release(item.m_blobId)) {
+
+            m_backend->store()->remove("blob3", UBJ_OBJ("rowid" << item.m_blobId));
+        }
+    };
+
+    // insert the nodes of imported files, optionally waiting for the next one
+
+    auto insert = [&] (bool wait) {
+
+        QList<ImportItem> items;
+
+        {
+            QMutexLocker locker(&mutex);
+
+            if (wait && finished.empty() && !failed && numFinished < numStarted) {
+
+                finishedCond.wait(&mutex);
+            }
+
+            if (failed) {
+
+                return false;
+            }
+
+            items.swap(finished);
+        }
+
+        for (qint32 i = 0; i < items.size(); ++i) {
+
+            const ImportItem &item = items[i];
+
+            if (!names.addNode(
+                        Store::File,
+                        item.m_name,
+                        item.m_parent,
+                        UBJ_OBJ(
+                            "size" << item.m_size <<
+                            "hash" << item.m_hash <<
+                            "data" << item.m_blobId))) {
+
+                for (; i < items.size(); ++i) {
+
+                    discard(items[i]);
+                }
+
+                QMutexLocker locker(&mutex);
+
+                failed = true;
+
+                return false;
+            }
+
+            filesDone++;
+
+            bytesDone += item.m_size;
+        }
+
+        report(false);
+
+        return true;
+    };
+
+    report(true);
+
+    QQueue<QPair<QString, uint64_t>> dirs;
+
+    for (auto &path : paths) {
+
+        QFileInfo info(path);
+
+        if (info.isFile()) {
+
+            start(info, dst);
+        }
+        else
+        if (info.isDir()) {
+
+            dirs.enqueue({info.absoluteFilePath(), dst});
+        }
+    }
+
+    bool res = true;
+
+    while (res && !dirs.empty()) {
+
+        auto entry = dirs.dequeue();
+
+        QDir dir(entry.first);
+
+        if (names.exists(entry.second, dir.dirName().toStdString(), Store::Directory)) {
+
+            res = false;
+
+            break;
+        }
+
+        uint64_t dirId = names.createDirectory(dir.dirName().toStdString(), entry.second);
+
+        if (!dirId) {
+
+            res = false;
+
+            break;
+        }
+
+        for (auto &file : dir.entryInfoList(QDir::NoFilter, QDir::DirsFirst)) {
+
+            if (file.fileName() == "." || file.fileName() == "..") {
+
+                continue;
+            }
+
+            if (file.isFile()) {
+
+                start(file, dirId);
+            }
+            else
+            if (file.isDir()) {
+
+                dirs.enqueue({file.absoluteFilePath(), dirId});
+            }
+        }
+
+        res = insert(false);
+    }
+
+    if (!res) {
+
+        QMutexLocker locker(&mutex);
+
+        failed = true;
+    }
+
+    while (insert(true)) {
+
+        QMutexLocker locker(&mutex);
+
+        if (numFinished == numStarted && finished.empty()) {
+
+            break;
+        }
+    }
+
+    // the workers reference this stack frame
+
+    {
+        QMutexLocker locker(&mutex);
+
+        while (numFinished < numStarted) {
+
+            finishedCond.wait(&mutex);
+        }
+
+        res = !failed;
+    }
+
+    // files which finished after a failure never got their node
+
+    for (auto &item : finished) {
+
+        discard(item);
+    }
+
+    report(true);
+
+    return res;
+}
+
+/**
+ * @brief LocalStoreModel::importFile
+ * @param item
+ * @return
+ */
+
+bool LocalStoreModel::importFile(ImportItem &item)
+{
+    QFile file(item.m_path);
+
+    if (!file.open(QFile::ReadOnly)) {
+
+        return false;
+    }
+
+    uint64_t size = file.size();
+
+    uint32_t chunkSize = m_importChunkSize;
+
+    // content of a size which is already stored is hashed first, a match only needs another reference
+
+    if (size && m_backend->blobIndex().hasSize(size)) {
+
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+
+        QByteArray buf;
+
+        while (!(buf = file.read(chunkSize)).isEmpty()) {
+
+            hash.addData(buf);
+        }
+
+        std::string digest = hash.result().toHex().toStdString();
+
+        uint64_t blobId = m_backend->blobIndex().acquire(digest, size);
+
+        if (blobId) {
+
+            item.m_size   = size;
+            item.m_blobId = blobId;
+            item.m_hash   = digest;
+
+            return true;
+        }
+
+        if (!file.seek(0)) {
+
+            return false;
+        }
+    }
+
+    uint64_t blobId = m_backend->store()->createBlob("blob3", size);
+
+    if (!blobId) {
+
+        return false;
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+
+    bool success = false;
+
+    m_backend->store()->writeBlob("blob3", blobId, [&] (bool error, UBJ::Store::Blob$ blob) {
+
+        if (error) {
+
+            return;
+        }
+
+        // two buffers, the next chunk is read and hashed while the current one is written
+
+        MemoryBuffer$ bufs[2] = {
+            MemoryBuffer::create(nullptr, chunkSize),
+            MemoryBuffer::create(nullptr, chunkSize)};
+
+        if (!bufs[0] || !bufs[1]) {
+
+            return;
+        }
+
+        ChunkPipe reader([&file, &hash] (MemoryBuffer$ buf, uint32_t numBytes, uint64_t) {
+
+            if (file.read((char*)buf->data(), numBytes) != numBytes) {
+
+                return false;
+            }
+
+            hash.addData((const char*)buf->data(), numBytes);
+
+            return true;
+        });
+
+        uint64_t bytesWritten = 0;
+
+        uint32_t bytesRead = qMin<uint64_t>(chunkSize, size);
+
+        if (bytesRead) {
+
+            reader.push(bufs[0], bytesRead, 0);
+        }
+
+        for (uint32_t i = 0; bytesRead > 0; i ^= 1) {
+
+            if (!reader.wait()) {
+
+                break;
+            }
+
+            uint64_t nextOffset = bytesWritten + bytesRead;
+
+            uint32_t nextBytes = qMin<uint64_t>(chunkSize, size - nextOffset);
+
+            if (nextBytes) {
+
+                reader.push(bufs[i ^ 1], nextBytes, nextOffset);
+            }
+
+            // a short or failed write stops here, the blob is removed below
+
+            if ((uint32_t)blob->write(bufs[i], bytesRead, bytesWritten) != bytesRead) {
+
+                break;
+            }
+
+            bytesWritten = nextOffset;
+
+            bytesRead = nextBytes;
+        }
+
+        success = bytesRead == 0 && bytesWritten == size;
+    });
+
+    if (!success) {
+
+        m_backend->store()->remove("blob3", UBJ_OBJ("rowid" << blobId));
+
+        return false;
+    }
+
+    item.m_size   = size;
+    item.m_blobId = blobId;
+    item.m_hash   = hash.result().toHex().toStdString();
+
+    m_backend->blobIndex().addRef(blobId, item.m_hash, size);
+
+    return true;
+}
+
+/**
+ * @brief LocalStoreModel::detachNode
+ * @param id
+ * @return
+ */
+
+bool LocalStoreModel::detachNode(uint64_t id)
+{
+    UBJ::Object node;
+
+    if (!m_backend->store()->query("vfs", UBJ_OBJ("rowid" << id), &node, {}, {"type", "parent", "size"})) {
+
+        return false;
+    }
+
+    // moving the row to the trash hides the whole subtree, the trash is reclaimed later,
+    // after a restart too, so neither rows nor blobs are lost on the way
+
+    if (!m_backend->store()->update("vfs", UBJ_OBJ("parent" << TrashDir), UBJ_OBJ("rowid" << id))) {
+
+        return false;
+    }
+
+    DirSizes &dirSizes = m_backend->dirSizes();
+
+    uint64_t parent = node["parent"].toLong();
+
+    if (node["type"].toInt() == Store::Directory) {
+
+        DirSizes::Entry entry;
+
+        if (dirSizes.get(id, entry)) {
+
+            dirSizes.adjust(m_backend->store(), parent, -(int64_t)entry.m_size, -(qint32)entry.m_numItems - 1);
+        }
+        else {
+
+            dirSizes.invalidate(m_backend->store(), parent);
+        }
+
+        dirSizes.remove(id);
+    }
+    else {
+
+        dirSizes.adjust(m_backend->store(), parent, -(int64_t)node["size"].toLong(), -1);
+    }
+
+    return true;
+}
+
+/**
+ * @brief LocalStoreModel::reclaimNodes
+ */
+
+void LocalStoreModel::reclaimNodes()
+{
+    quint32 numDeleted = 0;
+
+    bool done = false;
+
+    forever {
+
+        {
+            QMutexLocker locker(&m_deleteMutex);
+
+            // a cancelled job leaves the rest in the trash, the next delete or restart picks it up again
+
+            if (m_deleteCancelled.load() || (done && !m_deletePending)) {
+
+                m_deleteRunning = false;
+
+                break;
+            }
+
+            m_deletePending = false;
+        }
+
+        std::list<UBJ::Object> nodes;
+
+        m_backend->store()->query("vfs", UBJ_OBJ("parent" << TrashDir), nodes, {}, UBJ_ARR("rowid" << "type" << "data" << "hash" << "size"));
+
+        // rows the store refuses to remove stay in the trash until the next attempt
+
+        quint32 numBefore = numDeleted;
+
+        for (auto &node : nodes) {
+
+            if (m_deleteCancelled.load()) {
+
+                break;
+            }
+
+            uint64_t id = node["rowid"].toLong();
+
+            if (node["type"].toInt() == Store::Directory) {
+
+                // the children move to the trash with one statement before the directory goes
+
+                if (!m_backend->store()->update("vfs", UBJ_OBJ("parent" << TrashDir), UBJ_OBJ("parent" << id)) ||
+                    !m_backend->store()->remove("vfs", UBJ_OBJ("rowid" << id))) {
+
+                    continue;
+                }
+
+                m_backend->dirSizes().remove(id);
+            }
+            else {
+
+                uint64_t blobId = node["data"].toLong();
+
+                // blobs are shared between nodes with the same content, the store frees the last one with its node
+
+                if (blobId && m_backend->blobIndex().release(blobId)) {
+
+                    if (!m_backend->store()->deleteVfsNode(id)) {
+
+                        m_backend->blobIndex().addRef(blobId, node["hash"].toStr(), node["size"].toLong());
+
+                        continue;
+                    }
+                }
+                else
+                if (!m_backend->store()->remove("vfs", UBJ_OBJ("rowid" << id))) {
+
+                    if (blobId) {
+
+                        m_backend->blobIndex().addRef(blobId, node["hash"].toStr(), node["size"].toLong());
+                    }
+
+                    continue;
+                }
+            }
+
+            numDeleted++;
+
+            if (numDeleted % m_deleteProgressInterval == 0) {
+
+                emit deleteProgress(numDeleted, m_backend->store()->count("vfs", UBJ_OBJ("parent" << TrashDir)), false);
+
+                // let other store users in between batches
+
+                QThread::yieldCurrentThread();
+            }
+        }
+
+        done = numDeleted == numBefore;
+    }
+
+    emit deleteProgress(numDeleted, m_backend->store()->count("vfs", UBJ_OBJ("parent" << TrashDir)), true);
+}
+
+/**
+ * @brief LocalStoreModel::copyResource
+ * @param src
+ * @param dst
+ * @param names
+ * @return
+ */
+
+bool LocalStoreModel::copyResource(uint64_t src, uint64_t dst, VfsNameCache &names)
+{
+    UBJ::Object node;
+
+    if (!m_backend->store()->query("vfs", UBJ_OBJ("rowid" << src), &node)) {
+
+        return false;
+    }
+
+    if (names.exists(dst, node["name"].toStr())) {
+
+        return false;
+    }
+
+    return copyNode(node, dst, names);
+}
+
+/**
+ * @brief LocalStoreModel::copyNode
+ * @param node
+ * @param dst
+ * @param names
+ * @return
+ */
+
+bool LocalStoreModel::copyNode(UBJ::Object &node, uint64_t dst, VfsNameCache &names)
+{
+    // blobs are never written after creation, so the copy simply shares the blob of the source,
+    // the reference is taken first so a concurrent delete of the source can't free the blob meanwhile
+
+    uint64_t blobId = node["data"].toLong();
+
+    m_backend->blobIndex().addRef(blobId, node["hash"].toStr(), node["size"].toLong());
+
+    if (!names.addNode(
+                Store::File,
+                node["name"].toStr(),
+                dst,
+                UBJ_OBJ(
+                    "size" << node["size"] <<
+                    "hash" << node["hash"] <<
+                    "data" << node["data"]))) {
+
+        // no node was created, drop the reference again
+
+        if (blobId && m_backend->blobIndex().release(blobId)) {
+
+            m_backend->store()->remove("blob3", UBJ_OBJ("rowid" << blobId));
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief LocalStoreModel::copyDirectory
+ * @param src
+ * @param dst
+ * @param names
+ * @param recursive
+ * @return
+ */
+
+bool LocalStoreModel::copyDirectory(uint64_t src, uint64_t dst, VfsNameCache &names, bool recursive)
+{
+    if (src == dst || isAncestor(src, dst)) {
+
+        return false;
+    }
+
+    UBJ::Object node;
+
+    if (!m_backend->store()->query("vfs", UBJ_OBJ("rowid" << src), &node, {}, {"name"})) {
+
+        return false;
+    }
+
+    if (names.exists(dst, node["name"].toStr())) {
+
+        return false;
+    }
+
+    uint64_t dirId = names.createDirectory(node["name"].toStr(), dst);
+
+    if (!dirId) {
+
+        return false;
+    }
+
+    // walk the source tree level by level with one query per directory
+
+    QQueue<QPair<uint64_t, uint64_t>> dirs;
+
+    dirs.enqueue({src, dirId});
+
+    while (!dirs.empty()) {
+
+        auto entry = dirs.dequeue();
+
+        std::list<UBJ::Object> nodes;
+
+        m_backend->store()->query("vfs", UBJ_OBJ("parent" << entry.first), nodes, {}, UBJ_ARR("rowid" << "*"));
+
+        for (auto &child : nodes) {
+
+            if (child["type"].toInt() == Store::File) {
+
+                if (!copyNode(child, entry.second, names)) {
+
+                    return false;
+                }
+            }
+            else
+            if (child["type"].toInt() == Store::Directory && recursive) {
+
+                uint64_t childId = names.createDirectory(child["name"].toStr(), entry.second);
+
+                if (!childId) {
+
+                    return false;
+                }
+
+                dirs.enqueue({(uint64_t)child["rowid"].toLong(), childId});
             }
         }
     }
@@ -622,6 +1701,35 @@ bool LocalStoreModel::copyDirectory(uint64_t src, uint64_t dst, bool recursive)
     return true;
 }
 
+/**
+ * @brief LocalStoreModel::isAncestor
+ * @param ancestor
+ * @param id
+ * @return
+ */
+
+bool LocalStoreModel::isAncestor(uint64_t ancestor, uint64_t id)
+{
+    while (id) {
+
+        if (id == ancestor) {
+
+            return true;
+        }
+
+        UBJ::Object node;
+
+        if (!m_backend->store()->query("vfs", UBJ_OBJ("rowid" << id), &node, {}, {"parent"})) {
+
+            return false;
+        }
+
+        id = node["parent"].toLong();
+    }
+
+    return false;
+}
+
 /**
  * @brief LocalStoreModel::roleNames
  * @return
@@ -635,6 +1743,7 @@ QHash<int, QByteArray> LocalStoreModel::roleNames() const
     roles[TypeRole]   = "type";
     roles[NameRole]   = "name";
     roles[SizeRole]   = "size";
+    roles[MediaTypeRole] = "mediaType";
     roles[OriginRole] = "origin";
 
     return roles;
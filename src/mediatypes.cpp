@@ -0,0 +1,341 @@
+
+// ============================================================ //
+//
+//   d88888D db   d8b   db  .d8b.  db    db
+//   YP  d8' 88   I8I   88 d8' `8b `8b  d8'
+//      d8'  88   I8I   88 88ooo88  `8bd8'
+//     d8'   Y8   I8I   88 88~~~88    88
+//    d8' db `8b d8'8b d8' 88   88    88
+//   d88888P  `8b8' `8d8'  YP   YP    YP
+//
+//   open-source, cross-platform, crypto-messenger
+//
+//   Copyright (C) 2018 Marc Weiler
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program. If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================ //
+
+#include "mediatypes.h"
+
+#include <QFile>
+
+#include <Zway/memorybuffer.h>
+#include <Zway/ubj/store/blob.h>
+
+#include <cstring>
+
+// ============================================================ //
+
+/**
+ * @brief Number of bytes read to detect a media type
+ */
+
+static const size_t HeaderSize = 64;
+
+/**
+ * @brief Entries kept per cache before it is dropped
+ */
+
+static const qint32 MaxEntries = 65536;
+
+/**
+ * @brief MediaTypes::MediaTypes
+ */
+
+MediaTypes::MediaTypes()
+{
+
+}
+
+/**
+ * @brief MediaTypes::clear
+ */
+
+void MediaTypes::clear()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_files.clear();
+
+    m_blobs.clear();
+}
+
+/**
+ * @brief MediaTypes::fromFile
+ * @param path
+ * @param size
+ * @param time
+ * @return
+ */
+
+qint32 MediaTypes::fromFile(const QString &path, qint64 size, qint64 time)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+
+        auto it = m_files.find(path);
+
+        if (it != m_files.end() && it->m_size == size && it->m_time == time) {
+
+            return it->m_type;
+        }
+    }
+
+    FileEntry entry;
+
+    entry.m_size = size;
+    entry.m_time = time;
+
+    QFile file(path);
+
+    if (file.open(QFile::ReadOnly)) {
+
+        uint8_t header[HeaderSize];
+
+        qint64 numBytes = file.read((char*)header, HeaderSize);
+
+        entry.m_type = detect(header, numBytes > 0 ? numBytes : 0, size);
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    if (m_files.size() >= MaxEntries) {
+
+        m_files.clear();
+    }
+
+    m_files[path] = entry;
+
+    return entry.m_type;
+}
+
+/**
+ * @brief MediaTypes::fromBlob
+ * @param store
+ * @param blobId
+ * @param hash
+ * @return
+ */
+
+qint32 MediaTypes::fromBlob(Store$ store, uint64_t blobId, const std::string &hash)
+{
+    if (!store || !blobId) {
+
+        return Unknown;
+    }
+
+    // blob ids are reused once a blob is freed, the content hash tells them apart
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        auto it = m_blobs.find(blobId);
+
+        if (it != m_blobs.end() && it->m_hash == hash) {
+
+            return it->m_type;
+        }
+    }
+
+    BlobEntry entry;
+
+    entry.m_hash = hash;
+
+    store->readBlob("blob3", blobId, [&] (bool error, UBJ::Store::Blob$ blob) {
+
+        if (error) {
+
+            return;
+        }
+
+        size_t numBytes = qMin<uint64_t>(HeaderSize, blob->size());
+
+        MemoryBuffer$ buf = MemoryBuffer::create(nullptr, HeaderSize);
+
+        // a header which can't be read or decrypted stays unknown
+
+        if (buf && numBytes && blob->read(buf, numBytes, 0) == numBytes) {
+
+            entry.m_type = detect(buf->data(), numBytes, blob->size());
+        }
+    });
+
+    QMutexLocker locker(&m_mutex);
+
+    if (m_blobs.size() >= MaxEntries) {
+
+        m_blobs.clear();
+    }
+
+    m_blobs[blobId] = entry;
+
+    return entry.m_type;
+}
+
+/**
+ * @brief MediaTypes::detect
+ * @param data
+ * @param size
+ * @param totalSize
+ * @return
+ */
+
+qint32 MediaTypes::detect(const uint8_t *data, size_t size, uint64_t totalSize)
+{
+    auto match = [data, size] (size_t offset, const char *magic) {
+
+        size_t len = strlen(magic);
+
+        return size >= offset + len && !memcmp(data + offset, magic, len);
+    };
+
+    auto contains = [data, size] (const char *magic) {
+
+        size_t len = strlen(magic);
+
+        for (size_t offset = 0; offset + len <= size; ++offset) {
+
+            if (!memcmp(data + offset, magic, len)) {
+
+                return true;
+            }
+        }
+
+        return false;
+    };
+
+    auto u32 = [data] (size_t offset) {
+
+        return (uint32_t)data[offset] | (uint32_t)data[offset + 1] << 8 | (uint32_t)data[offset + 2] << 16 | (uint32_t)data[offset + 3] << 24;
+    };
+
+    // two letters alone are too common, the file size and a known dib header size have to fit too
+
+    auto bitmap = [&] () {
+
+        if (size < 18 || !match(0, "BM")) {
+
+            return false;
+        }
+
+        uint32_t fileSize = u32(2);
+
+        uint32_t dibSize = u32(14);
+
+        if (dibSize != 12 && dibSize != 40 && dibSize != 56 && dibSize != 108 && dibSize != 124) {
+
+            return false;
+        }
+
+        return fileSize >= 14 + dibSize && fileSize <= totalSize;
+    };
+
+    if (!size) {
+
+        return Unknown;
+    }
+
+    // images
+
+    if (match(0, "\xFF\xD8\xFF") ||
+        match(0, "\x89PNG\r\n\x1A\n") ||
+        match(0, "GIF87a") ||
+        match(0, "GIF89a") ||
+        bitmap() ||
+        match(0, "II*") ||
+        (match(0, "MM") && match(3, "*")) ||
+        (match(0, "RIFF") && match(8, "WEBP"))) {
+
+        return Image;
+    }
+
+    // iso base media, the major brand tells still images, audio and video apart
+
+    if (match(4, "ftyp")) {
+
+        if (match(8, "heic") || match(8, "heix") || match(8, "mif1") || match(8, "avif")) {
+
+            return Image;
+        }
+
+        if (match(8, "M4A ") || match(8, "M4B ")) {
+
+            return Audio;
+        }
+
+        return Video;
+    }
+
+    // ogg is a container, the first page carries the identification header of the first stream
+
+    if (match(0, "OggS")) {
+
+        if (match(28, "\x80theora") || match(28, "\x80" "daala")) {
+
+            return Video;
+        }
+
+        if (match(28, "\x01vorbis") || match(28, "OpusHead") || match(28, "Speex") || match(28, "\x7F" "FLAC")) {
+
+            return Audio;
+        }
+
+        return Other;
+    }
+
+    // ebml is only taken for video when the doc type names matroska or webm, audio only
+    // matroska files share the doc type and can't be told apart from the header alone
+
+    if (match(0, "\x1A\x45\xDF\xA3")) {
+
+        return contains("\x42\x82\x84webm") || contains("\x42\x82\x88matroska") ? Video : Other;
+    }
+
+    // video
+
+    if ((match(0, "RIFF") && match(8, "AVI ")) ||
+        match(0, "FLV") ||
+        match(0, "\x30\x26\xB2\x75\x8E\x66\xCF\x11")) {
+
+        return Video;
+    }
+
+    if (size >= 4 && !data[0] && !data[1] && data[2] == 1 && (data[3] == 0xBA || data[3] == 0xB3)) {
+
+        return Video;
+    }
+
+    // audio
+
+    if (match(0, "ID3") ||
+        match(0, "fLaC") ||
+        (match(0, "RIFF") && match(8, "WAVE")) ||
+        (match(0, "FORM") && match(8, "AIFF")) ||
+        match(0, "#!AMR")) {
+
+        return Audio;
+    }
+
+    // mpeg audio and adts frames start with an 11 or 12 bit sync word
+
+    if (size >= 2 && data[0] == 0xFF && (data[1] & 0xE0) == 0xE0) {
+
+        return Audio;
+    }
+
+    return Other;
+}
+
+// ============================================================ //
@@ -0,0 +1,390 @@
+
+// ============================================================ //
+//
+//   d88888D db   d8b   db  .d8b.  db    db
+//   YP  d8' 88   I8I   88 d8' `8b `8b  d8'
+//      d8'  88   I8I   88 88ooo88  `8bd8'
+//     d8'   Y8   I8I   88 88~~~88    88
+//    d8' db `8b d8'8b d8' 88   88    88
+//   d88888P  `8b8' `8d8'  YP   YP    YP
+//
+//   open-source, cross-platform, crypto-messenger
+//
+//   Copyright (C) 2018 Marc Weiler
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program. If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================ //
+
+#include "messageindex.h"
+
+#include <QRegularExpression>
+
+#include <algorithm>
+
+// ============================================================ //
+
+/**
+ * @brief Shorter last tokens are matched exactly, their prefix lists are too large
+ */
+
+static const qint32 MinPrefixLength = 3;
+
+/**
+ * @brief Characters of plain text kept per entry for result lists
+ */
+
+static const qint32 ExcerptLength = 80;
+
+/**
+ * @brief MessageIndex::MessageIndex
+ */
+
+MessageIndex::MessageIndex()
+    : m_building(false)
+{
+
+}
+
+/**
+ * @brief MessageIndex::clear
+ */
+
+void MessageIndex::clear()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_entries.clear();
+
+    m_postings.clear();
+
+    m_messages.clear();
+
+    m_historySizes.clear();
+
+    m_queued.clear();
+
+    m_building = false;
+}
+
+/**
+ * @brief MessageIndex::beginBuild
+ */
+
+void MessageIndex::beginBuild()
+{
+    clear();
+
+    QMutexLocker locker(&m_mutex);
+
+    m_building = true;
+}
+
+/**
+ * @brief MessageIndex::finishBuild
+ */
+
+void MessageIndex::finishBuild()
+{
+    QMutexLocker locker(&m_mutex);
+
+    // live messages go after the stored ones, so history indexes stay in order
+
+    for (auto &message : m_queued) {
+
+        QStringList tokens = tokenize(message.m_text);
+
+        tokens.removeDuplicates();
+
+        insertEntry(message, tokens, plainText(message.m_text).left(ExcerptLength));
+    }
+
+    m_queued.clear();
+
+    m_building = false;
+}
+
+/**
+ * @brief MessageIndex::addMessage
+ * @param messageId
+ * @param historyId
+ * @param contactId
+ * @param time
+ * @param text
+ */
+
+void MessageIndex::addMessage(quint32 messageId, quint32 historyId, quint32 contactId, quint64 time, const QString &text)
+{
+    // tokenize outside the lock, this is the expensive part, the excerpt spares searches a store query per hit
+
+    QStringList tokens = tokenize(text);
+
+    tokens.removeDuplicates();
+
+    QString excerpt = plainText(text).left(ExcerptLength);
+
+    QMutexLocker locker(&m_mutex);
+
+    insertEntry({messageId, historyId, contactId, time, QString()}, tokens, excerpt);
+}
+
+/**
+ * @brief MessageIndex::queueMessage
+ * @param messageId
+ * @param historyId
+ * @param contactId
+ * @param time
+ * @param text
+ */
+
+void MessageIndex::queueMessage(quint32 messageId, quint32 historyId, quint32 contactId, quint64 time, const QString &text)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+
+        // held back while the index is built, they are added once it is complete
+
+        if (m_building) {
+
+            m_queued.append({messageId, historyId, contactId, time, text});
+
+            return;
+        }
+    }
+
+    addMessage(messageId, historyId, contactId, time, text);
+}
+
+/**
+ * @brief MessageIndex::insertEntry
+ * @param message
+ * @param tokens
+ * @param excerpt
+ */
+
+void MessageIndex::insertEntry(const Pending &message, const QStringList &tokens, const QString &excerpt)
+{
+    if (m_messages.contains(message.m_messageId)) {
+
+        return;
+    }
+
+    quint32 entryId = m_entries.size();
+
+    Entry entry;
+
+    entry.m_messageId = message.m_messageId;
+    entry.m_historyId = message.m_historyId;
+    entry.m_contactId = message.m_contactId;
+    entry.m_index     = m_historySizes[message.m_historyId]++;
+    entry.m_time      = message.m_time;
+    entry.m_excerpt   = excerpt;
+
+    m_entries.append(entry);
+
+    m_messages[message.m_messageId] = entryId;
+
+    for (auto &token : tokens) {
+
+        m_postings[token].append(entryId);
+    }
+}
+
+/**
+ * @brief MessageIndex::removeHistory
+ * @param historyId
+ */
+
+void MessageIndex::removeHistory(quint32 historyId)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // entries are only flagged, posting lists keep their ids
+
+    for (auto &entry : m_entries) {
+
+        if (entry.m_historyId == historyId && !entry.m_removed) {
+
+            entry.m_removed = true;
+
+            m_messages.remove(entry.m_messageId);
+        }
+    }
+
+    m_historySizes.remove(historyId);
+}
+
+/**
+ * @brief MessageIndex::search
+ * @param query
+ * @param contactId
+ * @param limit
+ * @return
+ */
+
+QList<MessageIndex::Entry> MessageIndex::search(const QString &query, quint32 contactId, quint32 limit)
+{
+    QList<Entry> res;
+
+    QStringList tokens = tokenize(query);
+
+    tokens.removeDuplicates();
+
+    if (tokens.isEmpty()) {
+
+        return res;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    // the last token is matched as prefix, so results show up while typing
+
+    QList<QVector<quint32>> lists;
+
+    for (qint32 i=0; i<tokens.size(); ++i) {
+
+        bool prefix = i == tokens.size() - 1 && tokens[i].size() >= MinPrefixLength;
+
+        QVector<quint32> list = postings(tokens[i], prefix);
+
+        if (list.isEmpty()) {
+
+            return res;
+        }
+
+        lists.append(list);
+    }
+
+    std::sort(lists.begin(), lists.end(), [] (const QVector<quint32> &a, const QVector<quint32> &b) {
+
+        return a.size() < b.size();
+    });
+
+    QVector<quint32> hits = lists.takeFirst();
+
+    for (auto &list : lists) {
+
+        QVector<quint32> tmp;
+
+        std::set_intersection(hits.begin(), hits.end(), list.begin(), list.end(), std::back_inserter(tmp));
+
+        hits = tmp;
+
+        if (hits.isEmpty()) {
+
+            return res;
+        }
+    }
+
+    // newest messages first
+
+    for (auto it = hits.rbegin(); it != hits.rend() && (!limit || (quint32)res.size() < limit); ++it) {
+
+        const Entry &entry = m_entries[*it];
+
+        if (entry.m_removed || (contactId && entry.m_contactId != contactId)) {
+
+            continue;
+        }
+
+        res.append(entry);
+    }
+
+    return res;
+}
+
+/**
+ * @brief MessageIndex::numMessages
+ * @return
+ */
+
+quint32 MessageIndex::numMessages()
+{
+    QMutexLocker locker(&m_mutex);
+
+    return m_messages.size();
+}
+
+/**
+ * @brief MessageIndex::tokenize
+ * @param text
+ * @return
+ */
+
+QStringList MessageIndex::tokenize(const QString &text)
+{
+    static const QRegularExpression splitRex("[^\\w]+", QRegularExpression::UseUnicodePropertiesOption);
+
+    return plainText(text).toCaseFolded().split(splitRex, QString::SkipEmptyParts);
+}
+
+/**
+ * @brief MessageIndex::plainText
+ * @param text
+ * @return
+ */
+
+QString MessageIndex::plainText(const QString &text)
+{
+    static const QRegularExpression headRex("<head>.*</head>", QRegularExpression::DotMatchesEverythingOption);
+
+    static const QRegularExpression tagRex("<[^>]*>");
+
+    static const QRegularExpression entityRex("&\\w+;");
+
+    static const QRegularExpression spaceRex("\\s+");
+
+    QString plain = text;
+
+    plain.replace(headRex, " ").replace(tagRex, " ").replace(entityRex, " ").replace(spaceRex, " ");
+
+    return plain.trimmed();
+}
+
+/**
+ * @brief MessageIndex::postings
+ * @param token
+ * @param prefix
+ * @return
+ */
+
+QVector<quint32> MessageIndex::postings(const QString &token, bool prefix)
+{
+    if (!prefix) {
+
+        return m_postings.value(token);
+    }
+
+    QVector<quint32> res;
+
+    qint32 numLists = 0;
+
+    for (auto it = m_postings.lowerBound(token); it != m_postings.end() && it.key().startsWith(token); ++it) {
+
+        res += it.value();
+
+        numLists++;
+    }
+
+    if (numLists > 1) {
+
+        std::sort(res.begin(), res.end());
+
+        res.erase(std::unique(res.begin(), res.end()), res.end());
+    }
+
+    return res;
+}
+
+// ============================================================ //
@@ -0,0 +1,157 @@
+
+// ============================================================ //
+//
+//   d88888D db   d8b   db  .d8b.  db    db
+//   YP  d8' 88   I8I   88 d8' `8b `8b  d8'
+//      d8'  88   I8I   88 88ooo88  `8bd8'
+//     d8'   Y8   I8I   88 88~~~88    88
+//    d8' db `8b d8'8b d8' 88   88    88
+//   d88888P  `8b8' `8d8'  YP   YP    YP
+//
+//   open-source, cross-platform, crypto-messenger
+//
+//   Copyright (C) 2018 Marc Weiler
+//
+//   This program is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program. If not, see <http://www.gnu.org/licenses/>.
+//
+// ============================================================ //
+
+#include "vfsnamecache.h"
+
+// ============================================================ //
+
+/**
+ * @brief VfsNameCache::VfsNameCache
+ * @param store
+ */
+
+VfsNameCache::VfsNameCache(Store$ store)
+    : m_store(store),
+      m_numNodes(0)
+{
+
+}
+
+/**
+ * @brief VfsNameCache::exists
+ * @param parent
+ * @param name
+ * @param type
+ * @return
+ */
+
+bool VfsNameCache::exists(uint64_t parent, const std::string &name, qint32 type)
+{
+    QHash<QString, qint32> &names = children(parent);
+
+    auto it = names.find(QString::fromStdString(name));
+
+    if (it == names.end()) {
+
+        return false;
+    }
+
+    return type < 0 || *it == type;
+}
+
+/**
+ * @brief VfsNameCache::createDirectory
+ * @param name
+ * @param parent
+ * @return
+ */
+
+uint64_t VfsNameCache::createDirectory(const std::string &name, uint64_t parent)
+{
+    // directories are created right away, their id is needed for the children
+
+    uint64_t dirId = m_store->createVfsNode(Store::Directory, name, parent);
+
+    if (dirId) {
+
+        children(parent)[QString::fromStdString(name)] = Store::Directory;
+
+        // a new directory is empty, no need to ask the store
+
+        m_children[dirId] = QHash<QString, qint32>();
+
+        m_numNodes++;
+    }
+
+    return dirId;
+}
+
+/**
+ * @brief VfsNameCache::addNode
+ * @param type
+ * @param name
+ * @param parent
+ * @param data
+ * @return
+ */
+
+bool VfsNameCache::addNode(qint32 type, const std::string &name, uint64_t parent, const UBJ::Object &data)
+{
+    // the store has no transactions, a node is only reported once its row exists
+
+    if (!m_store->createVfsNode(type, name, parent, data)) {
+
+        return false;
+    }
+
+    children(parent)[QString::fromStdString(name)] = type;
+
+    m_numNodes++;
+
+    return true;
+}
+
+/**
+ * @brief VfsNameCache::numNodes
+ * @return
+ */
+
+quint32 VfsNameCache::numNodes() const
+{
+    return m_numNodes;
+}
+
+/**
+ * @brief VfsNameCache::children
+ * @param parent
+ * @return
+ */
+
+QHash<QString, qint32> &VfsNameCache::children(uint64_t parent)
+{
+    auto it = m_children.find(parent);
+
+    if (it == m_children.end()) {
+
+        it = m_children.insert(parent, QHash<QString, qint32>());
+
+        std::list<UBJ::Object> nodes;
+
+        m_store->query("vfs", UBJ_OBJ("parent" << parent), nodes, {}, {"name", "type"});
+
+        for (auto &node : nodes) {
+
+            (*it)[QString::fromStdString(node["name"].toStr())] = node["type"].toInt();
+        }
+    }
+
+    return *it;
+}
+
+// ============================================================ //